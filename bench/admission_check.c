@@ -0,0 +1,63 @@
+// Regression check for admission control: runs more jobs than
+// admit_max_in_flight through the offline RR and MLFQ schedulers and fails
+// if either stops making progress or leaves a job unfinished.
+//
+//   gcc -O2 bench/admission_check.c -o admission_check -lpthread -lm
+//   ./admission_check
+
+#include "../offline_schedulers.h"
+
+// ------------------ CONSTANTS ------------------
+#define CHECK_JOBS 5
+#define CHECK_TIMEOUT_S 30
+
+void check_timeout(int sig)
+{
+    const char msg[] = "admission_check: FAIL (no progress, scheduler livelocked)\n";
+    if (write(STDERR_FILENO, msg, sizeof(msg) - 1) < 0)
+    {
+        _exit(1);
+    }
+    // Takes the stopped jobs down too; main() gave them their own group.
+    kill(0, SIGKILL);
+}
+
+int check_policy(const char *name)
+{
+    Process p[CHECK_JOBS];
+    memset(p, 0, sizeof(p));
+    for (int i = 0; i < CHECK_JOBS; i++)
+    {
+        p[i].command = strdup("sleep 0.2");
+    }
+
+    alarm(CHECK_TIMEOUT_S);
+    if (strcmp(name, "RR") == 0)
+    {
+        RoundRobin(p, CHECK_JOBS, 50);
+    }
+    else
+    {
+        MultiLevelFeedbackQueue(p, CHECK_JOBS, 50, 100, 200, 1000);
+    }
+    alarm(0);
+
+    int done = 0;
+    for (int i = 0; i < CHECK_JOBS; i++)
+    {
+        done += p[i].finished;
+        free(p[i].command);
+    }
+    fprintf(stderr, "admission_check %s: %d/%d jobs finished\n", name, done, CHECK_JOBS);
+    return done == CHECK_JOBS ? 0 : 1;
+}
+
+int main()
+{
+    setpgid(0, 0);
+    signal(SIGALRM, check_timeout);
+    admit_max_in_flight = 2;
+    int failed = check_policy("RR") + check_policy("MLFQ");
+    fprintf(stderr, "admission_check: %s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,336 @@
+// Microbenchmarks for the online scheduler's hot-path helpers.
+//
+//   gcc -O2 bench/microbench.c -o microbench -lpthread -lm
+//   ./microbench [--max-jobs N] [--max-cmds N] [--baseline old.json] > new.json
+//
+// Output is JSON with one benchmark object per line. With --baseline, each
+// entry also carries the baseline ns/op and the ratio new / baseline.
+
+#define MAX_CMDS 100000
+
+#include "../online_schedulers.h"
+
+// ------------------ CONSTANTS ------------------
+#define BENCH_MIN_NS 20000000ULL
+#define BENCH_MAX_BASELINE 256
+#define BENCH_MAX_JOBS 1000000
+
+typedef struct
+{
+    char name[64];
+    long n;
+    double ns_per_op;
+} BenchResult;
+
+BenchResult baseline[BENCH_MAX_BASELINE];
+int baseline_count = 0;
+bool first_result = true;
+volatile uint64_t bench_sink = 0;
+
+void load_baseline(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        perror("baseline open failed");
+        return;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), fp) && baseline_count < BENCH_MAX_BASELINE)
+    {
+        BenchResult *b = &baseline[baseline_count];
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"n\": %ld, \"ns_per_op\": %lf", b->name, &b->n, &b->ns_per_op) == 3)
+        {
+            baseline_count++;
+        }
+    }
+    fclose(fp);
+}
+
+void report(const char *name, long n, uint64_t elapsed_ns, uint64_t ops)
+{
+    double ns_per_op = (double)elapsed_ns / (double)ops;
+    printf("%s    {\"name\": \"%s\", \"n\": %ld, \"ns_per_op\": %.3f, \"ops\": %llu",
+           first_result ? "" : ",\n", name, n, ns_per_op, (unsigned long long)ops);
+    first_result = false;
+    for (int i = 0; i < baseline_count; i++)
+    {
+        if (strcmp(baseline[i].name, name) == 0 && baseline[i].n == n)
+        {
+            printf(", \"baseline_ns_per_op\": %.3f, \"ratio\": %.3f",
+                   baseline[i].ns_per_op, ns_per_op / baseline[i].ns_per_op);
+            break;
+        }
+    }
+    printf("}");
+    fflush(stdout);
+}
+
+uint64_t next_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void reset_history(int cmds)
+{
+    for (int j = 0; j < total_cmds; j++)
+    {
+        free(cmd_history[j]);
+        cmd_history[j] = NULL;
+    }
+    memset(burst_count, 0, sizeof(burst_count));
+    memset(burst_sum, 0, sizeof(burst_sum));
+    total_cmds = 0;
+
+    char cmd[64];
+    for (int j = 0; j < cmds; j++)
+    {
+        snprintf(cmd, sizeof(cmd), "./job --input data/file_%06d.txt", j);
+        cmd_history[total_cmds++] = strdup(cmd);
+    }
+}
+
+// Fills one level and drains it the way online MLFQ queues and dispatches.
+void bench_lq_push_pop(long n)
+{
+    LevelQueues lq;
+    if (lq_init(&lq, 3, (int)n) < 0)
+    {
+        return;
+    }
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            lq_push(&lq, 1, (int)i);
+        }
+        for (long i = 0; i < n; i++)
+        {
+            bench_sink += lq_pop_highest(&lq, NULL);
+        }
+        ops += n;
+    }
+    report("lq_push_pop", n, mono_time_ns() - start, ops);
+    lq_free(&lq);
+}
+
+void bench_find_cmd_index(long cmds)
+{
+    reset_history(cmds);
+    uint64_t rng = 88172645463325252ULL;
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (int r = 0; r < 16; r++)
+        {
+            bench_sink += find_cmd_index(cmd_history[next_rand(&rng) % cmds]);
+        }
+        ops += 16;
+    }
+    report("find_cmd_index", cmds, mono_time_ns() - start, ops);
+}
+
+void bench_register_burst(long cmds)
+{
+    reset_history(cmds);
+    uint64_t rng = 88172645463325252ULL;
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (int r = 0; r < 1024; r++)
+        {
+            register_burst_global((int)(next_rand(&rng) % cmds), (double)(r % 300), false);
+        }
+        ops += 1024;
+    }
+    report("register_burst_global", cmds, mono_time_ns() - start, ops);
+}
+
+void bench_estimate_burst(long cmds)
+{
+    reset_history(cmds);
+    for (long j = 0; j < cmds; j++)
+    {
+        for (int h = 0; h < 8; h++)
+        {
+            register_burst_global((int)j, (double)(h * 10 + j % 7), false);
+        }
+    }
+    uint64_t rng = 88172645463325252ULL;
+    double acc = 0.0;
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (int r = 0; r < 1024; r++)
+        {
+            acc += estimate_burst((int)(next_rand(&rng) % cmds), 5);
+        }
+        ops += 1024;
+    }
+    bench_sink += (uint64_t)acc;
+    report("estimate_burst", cmds, mono_time_ns() - start, ops);
+}
+
+void bench_select_shortest_job(long n)
+{
+    Process *p = calloc(n, sizeof(Process));
+    bool *finished = calloc(n, sizeof(bool));
+    uint64_t rng = 88172645463325252ULL;
+    for (long i = 0; i < n; i++)
+    {
+        p[i].est_burst = (double)(next_rand(&rng) % 100000);
+        finished[i] = (i % 4) == 0;
+    }
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        bench_sink += select_shortest_job(p, finished, (int)n);
+        ops++;
+    }
+    report("select_shortest_job", n, mono_time_ns() - start, ops);
+    free(p);
+    free(finished);
+}
+
+void bench_mlfq_boost(const char *name, long n, int levels)
+{
+    LevelQueues lq;
+    if (lq_init(&lq, levels, (int)n) < 0)
+    {
+        return;
+    }
+    int *level = calloc(n, sizeof(int));
+    uint64_t elapsed = 0;
+    uint64_t ops = 0;
+    while (elapsed < BENCH_MIN_NS)
+    {
+        for (long i = 0; i < n; i++)
+        {
+            level[i] = 1 + (int)(i % (levels - 1));
+            lq_push(&lq, level[i], (int)i);
+        }
+        uint64_t start = mono_time_ns();
+        mlfq_boost_queues(&lq, level);
+        elapsed += mono_time_ns() - start;
+        while (lq_pop(&lq, 0) != -1)
+        {
+        }
+        ops += n;
+    }
+    report(name, n, elapsed, ops);
+    free(level);
+    lq_free(&lq);
+}
+
+void bench_mlfq_dispatch(long n, int levels)
+{
+    LevelQueues lq;
+    if (lq_init(&lq, levels, (int)n) < 0)
+    {
+        return;
+    }
+    for (long i = 0; i < n; i++)
+    {
+        lq_push(&lq, (int)(i % levels), (int)i);
+    }
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (int r = 0; r < 1024; r++)
+        {
+            int l = 0;
+            int id = lq_pop_highest(&lq, &l);
+            lq_push(&lq, l < levels - 1 ? l + 1 : 0, id);
+        }
+        ops += 1024;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "mlfq_dispatch_%dlevels", levels);
+    report(name, n, mono_time_ns() - start, ops);
+    lq_free(&lq);
+}
+
+void bench_parse_command(long tokens)
+{
+    char line[READ_BUF];
+    int len = snprintf(line, sizeof(line), "./job");
+    for (long t = 1; t < tokens && len < (int)sizeof(line) - 16; t++)
+    {
+        len += snprintf(line + len, sizeof(line) - len, " --arg%ld", t);
+    }
+    char copy[READ_BUF];
+    uint64_t ops = 0;
+    uint64_t start = mono_time_ns();
+    while (mono_time_ns() - start < BENCH_MIN_NS)
+    {
+        for (int r = 0; r < 256; r++)
+        {
+            memcpy(copy, line, len + 1);
+            char **argv = parse_command(copy);
+            bench_sink += (uint64_t)(uintptr_t)argv[0];
+        }
+        ops += 256;
+    }
+    report("parse_command", tokens, mono_time_ns() - start, ops);
+}
+
+int main(int argc, char *argv[])
+{
+    long max_jobs = BENCH_MAX_JOBS;
+    long max_cmds = MAX_CMDS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--max-jobs") == 0 && i + 1 < argc)
+        {
+            max_jobs = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-cmds") == 0 && i + 1 < argc)
+        {
+            max_cmds = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            load_baseline(argv[++i]);
+        }
+    }
+    if (max_cmds > MAX_CMDS)
+    {
+        max_cmds = MAX_CMDS;
+    }
+    if (max_jobs > BENCH_MAX_JOBS)
+    {
+        max_jobs = BENCH_MAX_JOBS;
+    }
+
+    printf("{\"benchmarks\": [\n");
+    for (long n = 10; n <= max_jobs; n *= 10)
+    {
+        bench_lq_push_pop(n);
+        bench_select_shortest_job(n);
+        bench_mlfq_boost("mlfq_boost_3levels", n, 3);
+        bench_mlfq_boost("mlfq_boost_64levels", n, 64);
+        bench_mlfq_dispatch(n, 3);
+        bench_mlfq_dispatch(n, 64);
+    }
+    for (long c = 10; c <= max_cmds; c *= 10)
+    {
+        bench_find_cmd_index(c);
+        bench_register_burst(c);
+        bench_estimate_burst(c);
+    }
+    bench_parse_command(1);
+    bench_parse_command(10);
+    bench_parse_command(99);
+    printf("\n]}\n");
+    return 0;
+}
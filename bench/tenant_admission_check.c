@@ -0,0 +1,60 @@
+// Regression check for tenant fair share under admission control: feeds two
+// tenants' jobs to the online MLFQ with admit_max_in_flight = 1 and fails if
+// either tenant's job is left unfinished when the run is stopped.
+//
+//   gcc -O2 bench/tenant_admission_check.c -o tenant_admission_check -lpthread -lm
+//   ./tenant_admission_check
+
+#include "../online_schedulers.h"
+
+// ------------------ CONSTANTS ------------------
+#define CHECK_RUN_S 5
+
+const char *check_jobs[] = {"@tenant=A sleep 0.3", "@tenant=B sleep 0.3"};
+#define CHECK_JOBS (int)(sizeof(check_jobs) / sizeof(check_jobs[0]))
+
+void check_stop(int sig)
+{
+    terminate_flag = 1;
+}
+
+int main()
+{
+    int fds[2];
+    if (pipe(fds) < 0)
+    {
+        perror("pipe");
+        return 1;
+    }
+    for (int i = 0; i < CHECK_JOBS; i++)
+    {
+        dprintf(fds[1], "%s\n", check_jobs[i]);
+    }
+    close(fds[1]);
+    dup2(fds[0], STDIN_FILENO);
+    close(fds[0]);
+
+    setpgid(0, 0);
+    tenant_fair_share = true;
+    admit_max_in_flight = 1;
+    signal(SIGALRM, check_stop);
+    alarm(CHECK_RUN_S);
+    MultiLevelFeedbackQueue(50, 100, 200, 1000);
+
+    int failed = 0;
+    for (int t = 0; t < tenant_count; t++)
+    {
+        fprintf(stderr, "tenant_admission_check %s: %d jobs finished\n", tenants[t].name, tenants[t].jobs_done);
+        failed += tenants[t].jobs_done != 1;
+    }
+    failed += tenant_count != CHECK_JOBS;
+    fprintf(stderr, "tenant_admission_check: %s\n", failed ? "FAIL" : "PASS");
+    if (failed)
+    {
+        // A job left stopped by the stuck scheduler shares our group.
+        signal(SIGTERM, SIG_IGN);
+        kill(0, SIGTERM);
+        kill(0, SIGCONT);
+    }
+    return failed ? 1 : 0;
+}
@@ -1,4 +1,7 @@
 #pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 
 // Can include any other headers as needed
 
@@ -15,6 +18,21 @@
 #include <fcntl.h>
 #include <string.h>
 
+#include "utils/admission.h"
+#include "utils/pageout.h"
+#include "utils/affinity.h"
+#include "utils/level_queue.h"
+#include "utils/job_meta.h"
+#include "utils/vruntime_heap.h"
+#include "utils/trace.h"
+#include "utils/gang.h"
+#include "utils/job_limits.h"
+#include "utils/precision.h"
+#include "utils/yield_doorbell.h"
+#include "utils/output_capture.h"
+#include "utils/burst_model.h"
+#include "utils/burst_stats.h"
+
 #define MAX_PROCS 100
 #define MAX_QUEUE 100
 
@@ -36,6 +54,9 @@ typedef struct
 void FCFS(Process p[], int n);
 void RoundRobin(Process p[], int n, int quantum);
 void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int quantum2, int boostTime);
+void MultiLevelFeedbackQueueN(Process p[], int n, int levels, const int quanta[], int boostTime);
+void CompletelyFair(Process p[], int n, int target_latency, int min_granularity);
+void HistoryPlan(Process p[], int n, int cores);
 
 uint64_t get_time_ms()
 {
@@ -58,17 +79,43 @@ char **parse_command(char *command)
     return argv;
 }
 
+// A job whose fork() failed never ran. It still gets a row, marked
+// ForkFailed, instead of missing from the CSV.
+void write_fork_failed(FILE *csv, Process *p, uint64_t now)
+{
+    p->finished = false;
+    p->error = true;
+    p->completion_time = now;
+    p->turnaround_time = now;
+    p->waiting_time = now;
+    p->response_time = now;
+    fprintf(csv, "%s,No,ForkFailed,%llu,%llu,%llu,%llu\n",
+            p->command,
+            (unsigned long long)p->completion_time,
+            (unsigned long long)p->turnaround_time,
+            (unsigned long long)p->waiting_time,
+            (unsigned long long)p->response_time);
+    fflush(csv);
+}
+
 void FCFS(Process p[], int n)
 {
     uint64_t scheduler_start = get_time_ms();
     FILE *csv = fopen("result_offline_FCFS_output.csv", "w");
+    trace_begin("offline FCFS");
+    limits_begin();
+    JobLimit limit;
+    CaptureState capture;
 
     for (int i = 0; i < n; i++)
     {
+        JobMeta meta;
+        strip_job_meta(p[i].command, &meta);
         p[i].started = true;
         uint64_t start = get_time_ms() - scheduler_start;
         p[i].start_time = start;
 
+        capture_prepare(&capture, i);
         int pid = fork();
         if (pid == 0)
         {
@@ -76,6 +123,9 @@ void FCFS(Process p[], int n)
             strncpy(cmd_copy, p[i].command, sizeof(cmd_copy) - 1);
             cmd_copy[sizeof(cmd_copy) - 1] = '\0';
             char **argv = parse_command(cmd_copy);
+            capture_child(&capture);
+            precision_child();
+            gang_exec_pipeline(p[i].command);
             execvp(argv[0], argv);
 
             perror("execvp failed");
@@ -83,8 +133,14 @@ void FCFS(Process p[], int n)
         }
         else if (pid > 0)
         {
+            gang_parent(pid, p[i].command);
+            capture_parent(&capture, true);
+            limit_job_start(&limit, pid, meta.cpu_limit_ms, meta.wall_limit_ms);
+            limit_job_resumed(&limit);
             int status;
-            waitpid(pid, &status, 0);
+            capture_waitpid(pid, &status);
+            limit_job_exited(&limit);
+            capture_job_exited(&capture);
 
             uint64_t end = get_time_ms() - scheduler_start;
             p[i].completion_time = end;
@@ -100,11 +156,12 @@ void FCFS(Process p[], int n)
                    p[i].command,
                    (unsigned long long)p[i].start_time,
                    (unsigned long long)p[i].completion_time);
+            trace_slice(p[i].command, -1, p[i].start_time, p[i].completion_time);
 
             fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
                     p[i].command,
                     p[i].finished ? "Yes" : "No",
-                    p[i].error ? "Yes" : "No",
+                    limit_error_field(&limit, p[i].error),
                     (unsigned long long)p[i].completion_time,
                     (unsigned long long)p[i].turnaround_time,
                     (unsigned long long)p[i].waiting_time,
@@ -114,10 +171,15 @@ void FCFS(Process p[], int n)
         else
         {
             perror("fork failed");
+            capture_parent(&capture, false);
+            write_fork_failed(csv, &p[i], get_time_ms() - scheduler_start);
             continue;
         }
     }
 
+    limits_end();
+    capture_end();
+    trace_end();
     fclose(csv);
 }
 
@@ -153,38 +215,68 @@ void RoundRobin(Process p[], int n, int quantum)
     uint64_t scheduler_start = get_time_ms();
 
     FILE *csv = fopen("result_offline_RR_output.csv", "w");
+    trace_begin("offline RR");
+    limits_begin();
+    precision_begin();
+    yield_begin();
+    yield_arm();
 
     pid_t pids[MAX_PROCS] = {0};
     bool started[MAX_PROCS] = {0};
     bool finished[MAX_PROCS] = {0};
     int slices_used[MAX_PROCS] = {0};
+    AffinityState affinity[MAX_PROCS] = {0};
+    JobLimit limits[MAX_PROCS];
+    CaptureState capture[MAX_PROCS];
     int remaining = n;
 
     int queue[MAX_QUEUE];
 
     int front = 0;
     int rear = 0;
+    int parked[MAX_PROCS];
+    int parked_count = 0;
 
     for (int i = 0; i < n; i++)
     {
         enque(queue, &front, &rear, i);
     }
 
-    while (remaining > 0 && front < rear)
+    while (remaining > 0 && (!isEmpty(front, rear) || parked_count > 0))
     {
+        limits_poll();
+        if (isEmpty(front, rear))
+        {
+            for (int k = 0; k < parked_count; k++)
+            {
+                enque(queue, &front, &rear, parked[k]);
+            }
+            parked_count = 0;
+        }
         int i = deque(queue, &front, &rear);
-        if (finished[i] || (i == -1))
+        if (i == -1 || finished[i])
         {
             continue;
         }
 
+        // A deferred job sits out until the next slice ends, so an admitted
+        // job gets the CPU instead of the same job being picked again.
+        if (!started[i] && !admission_open(pids, finished, n))
+        {
+            parked[parked_count++] = i;
+            continue;
+        }
+
         uint64_t slice_start = get_time_ms() - scheduler_start;
         if (!started[i])
         {
+            JobMeta meta;
+            strip_job_meta(p[i].command, &meta);
             p[i].started = true;
             p[i].start_time = slice_start;
             started[i] = true;
 
+            capture_prepare(&capture[i], i);
             int pid = fork();
 
             if (pid == 0)
@@ -193,29 +285,43 @@ void RoundRobin(Process p[], int n, int quantum)
                 strncpy(cmd_copy, p[i].command, sizeof(cmd_copy) - 1);
                 cmd_copy[sizeof(cmd_copy) - 1] = '\0';
                 char **argv = parse_command(cmd_copy);
+                capture_child(&capture[i]);
+                precision_child();
+                gang_exec_pipeline(p[i].command);
                 execvp(argv[0], argv);
                 perror("execvp failed");
                 _exit(EXIT_FAILURE);
             }
             else if (pid > 0)
             {
+                gang_parent(pid, p[i].command);
+                capture_parent(&capture[i], true);
                 p[i].process_id = pid;
                 pids[i] = pid;
-                kill(pid, SIGSTOP);
+                job_signal(pid, SIGSTOP);
+                limit_job_start(&limits[i], pid, meta.cpu_limit_ms, meta.wall_limit_ms);
             }
             else
             {
                 perror("fork failed");
+                capture_parent(&capture[i], false);
+                write_fork_failed(csv, &p[i], get_time_ms() - scheduler_start);
+                finished[i] = true;
+                remaining--;
                 continue;
             }
         }
 
         if (remaining == 1)
         {
-            kill(pids[i], SIGCONT);
+            affinity_job_resuming(&affinity[i], pids[i]);
+            limit_job_resumed(&limits[i]);
+            job_signal(pids[i], SIGCONT);
 
             int status;
-            waitpid(pids[i], &status, 0); 
+            capture_waitpid(pids[i], &status);
+            limit_job_exited(&limits[i]);
+            capture_job_exited(&capture[i]);
 
             uint64_t slice_end = get_time_ms() - scheduler_start;
 
@@ -224,6 +330,7 @@ void RoundRobin(Process p[], int n, int quantum)
                    (unsigned long long)slice_start,
                    (unsigned long long)slice_end);
             fflush(stdout);
+            trace_slice(p[i].command, -1, slice_start, slice_end);
 
             p[i].completion_time = slice_end;
             p[i].finished = WIFEXITED(status);
@@ -238,7 +345,7 @@ void RoundRobin(Process p[], int n, int quantum)
             fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
                     p[i].command,
                     p[i].finished ? "Yes" : "No",
-                    p[i].error ? "Yes" : "No",
+                    limit_error_field(&limits[i], p[i].error),
                     (unsigned long long)p[i].completion_time,
                     (unsigned long long)p[i].turnaround_time,
                     (unsigned long long)p[i].waiting_time,
@@ -247,13 +354,52 @@ void RoundRobin(Process p[], int n, int quantum)
             break; 
         }
 
-        kill(pids[i], SIGCONT);
+        affinity_job_resuming(&affinity[i], pids[i]);
+        limit_job_resumed(&limits[i]);
+        job_signal(pids[i], SIGCONT);
+        SliceTimer timer;
+        slice_timer_start(&timer, quantum);
         slices_used[i]++;
 
+        int hint_ms = 0;
+        bool yielded = false;
         struct timespec ts = {.tv_sec = quantum / 1000, .tv_nsec = (quantum % 1000) * 1000000};
-        nanosleep(&ts, NULL);
+        if (capture_live_count > 0)
+        {
+            // The doorbell signal cuts poll() short, so a yield ends the wait
+            // while output is being drained too.
+            while (!slice_timer_expired(&timer) && !yielded)
+            {
+                uint64_t now_ns = mono_time_ns();
+                int left_ms = timer.deadline_ns > now_ns ? (int)((timer.deadline_ns - now_ns + 999999) / 1000000) : 0;
+                capture_poll(left_ms);
+                yielded = yield_doorbell_enabled && yield_requested(pids[i], &hint_ms);
+            }
+        }
+        else if (precision_mode || yield_doorbell_enabled)
+        {
+            while (!slice_timer_expired(&timer) && !yielded)
+            {
+                precision_sleep_until(timer.deadline_ns);
+                yielded = yield_doorbell_enabled && yield_requested(pids[i], &hint_ms);
+            }
+        }
+        else
+        {
+            nanosleep(&ts, NULL);
+        }
 
-        kill(pids[i], SIGSTOP);
+        job_signal(pids[i], SIGSTOP);
+        if (yielded)
+        {
+            yield_stopped(hint_ms);
+        }
+        else
+        {
+            slice_timer_stopped(&timer);
+        }
+        limit_job_stopped(&limits[i]);
+        affinity_job_stopped(&affinity[i], pids[i]);
 
         uint64_t slice_end = get_time_ms() - scheduler_start;
         printf("%s, %llu, %llu\n",
@@ -261,12 +407,20 @@ void RoundRobin(Process p[], int n, int quantum)
                (unsigned long long)slice_start,
                (unsigned long long)slice_end);
         fflush(stdout);
+        trace_slice(p[i].command, -1, slice_start, slice_end);
+        for (int k = 0; k < parked_count; k++)
+        {
+            enque(queue, &front, &rear, parked[k]);
+        }
+        parked_count = 0;
 
         int status;
         pid_t result = waitpid(pids[i], &status, WNOHANG);
 
         if (result == pids[i])
         {
+            limit_job_exited(&limits[i]);
+            capture_job_exited(&capture[i]);
             p[i].completion_time = slice_end;
             p[i].finished = WIFEXITED(status);
             p[i].error = !p[i].finished;
@@ -280,7 +434,7 @@ void RoundRobin(Process p[], int n, int quantum)
             fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
                     p[i].command,
                     p[i].finished ? "Yes" : "No",
-                    p[i].error ? "Yes" : "No",
+                    limit_error_field(&limits[i], p[i].error),
                     (unsigned long long)p[i].completion_time,
                     (unsigned long long)p[i].turnaround_time,
                     (unsigned long long)p[i].waiting_time,
@@ -289,60 +443,91 @@ void RoundRobin(Process p[], int n, int quantum)
         }
         else
         {
+            trace_preempt(p[i].command, slice_end);
             enque(queue, &front, &rear, i);
         }
     }
 
+    limits_end();
+    precision_end();
+    yield_end();
+    capture_end();
+    affinity_report();
+    trace_end();
     fclose(csv);
 }
 
 // ############################################################
 void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int quantum2, int boostTime)
+{
+    int quanta[3] = {quantum0, quantum1, quantum2};
+    MultiLevelFeedbackQueueN(p, n, 3, quanta, boostTime);
+}
+
+// quanta[l] is the time slice of level l; level 0 has the highest priority.
+void MultiLevelFeedbackQueueN(Process p[], int n, int levels, const int quanta[], int boostTime)
 {
     uint64_t scheduler_start = get_time_ms();
+
+    LevelQueues lq;
+    if (lq_init(&lq, levels, MAX_PROCS) < 0)
+    {
+        fprintf(stderr, "invalid MLFQ level count: %d\n", levels);
+        return;
+    }
+
     FILE *csv = fopen("result_offline_MLFQ_output.csv", "w");
+    trace_begin("offline MLFQ");
+    limits_begin();
+    precision_begin();
+    yield_begin();
+    yield_arm();
 
     pid_t pids[MAX_PROCS] = {0};
     bool started[MAX_PROCS] = {0};
     bool finished[MAX_PROCS] = {0};
     int remaining = n;
     uint64_t cpu_time_used_ms[MAX_PROCS] = {0};
-
-    int q0[MAX_QUEUE], q1[MAX_QUEUE], q2[MAX_QUEUE];
-    int f0 = 0, r0 = 0, f1 = 0, r1 = 0, f2 = 0, r2 = 0;
-
+    PageoutState pageout[MAX_PROCS] = {0};
+    AffinityState affinity[MAX_PROCS] = {0};
+    JobLimit limits[MAX_PROCS];
+    CaptureState capture[MAX_PROCS];
+    int level[MAX_PROCS] = {0};
 
     for (int i = 0; i < n; i++)
     {
-        enque(q0, &f0, &r0, i);
+        lq_push(&lq, 0, i);
     }
 
     uint64_t next_boost_time = boostTime;
 
 
-    while (remaining > 0 && (f0 != r0 || f1 != r1 || f2 != r2))
-    {
-        int idx = -1;
-        int this_quantum = 0;
+    int parked[MAX_PROCS];
+    int parked_count = 0;
 
-        if (f0 != r0)
-        {
-            idx = deque(q0, &f0, &r0);
-            this_quantum = quantum0;
-        }
-        else if (f1 != r1)
+    while (remaining > 0 && (!lq_empty(&lq) || parked_count > 0))
+    {
+        if (lq_empty(&lq))
         {
-            idx = deque(q1, &f1, &r1);
-            this_quantum = quantum1;
+            while (parked_count > 0)
+            {
+                int id = parked[--parked_count];
+                lq_push_front(&lq, level[id], id);
+            }
         }
-        else if (f2 != r2)
+        int idx = lq_pop_highest(&lq, NULL);
+
+        if (idx == -1 || finished[idx])
         {
-            idx = deque(q2, &f2, &r2);
-            this_quantum = quantum2;
+            continue;
         }
+        int this_quantum = quanta[level[idx]];
 
-        if (idx == -1 || finished[idx])
+        // A deferred job sits out until the next slice ends, so an admitted
+        // job gets the CPU instead of the same job being picked again.
+        if (!started[idx] && !admission_open(pids, finished, n))
         {
+            parked[parked_count++] = idx;
             continue;
         }
 
@@ -351,10 +536,13 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
 
         if (!started[idx])
         {
+            JobMeta meta;
+            strip_job_meta(p[idx].command, &meta);
             started[idx] = true;
             p[idx].started = true;
             p[idx].start_time = slice_start;
 
+            capture_prepare(&capture[idx], idx);
             pid_t pid = fork();
             if (pid == 0)
             {
@@ -362,28 +550,40 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
                 strncpy(cmd_copy, p[idx].command, sizeof(cmd_copy) - 1);
                 cmd_copy[sizeof(cmd_copy) - 1] = '\0';
                 char **argv = parse_command(cmd_copy);
+                capture_child(&capture[idx]);
+                precision_child();
+                gang_exec_pipeline(p[idx].command);
                 execvp(argv[0], argv);
                 perror("execvp failed");
                 _exit(EXIT_FAILURE);
             }
             else if (pid > 0)
             {
+                gang_parent(pid, p[idx].command);
+                capture_parent(&capture[idx], true);
                 p[idx].process_id = pid;
                 pids[idx] = pid;
-                kill(pid, SIGSTOP);
+                job_signal(pid, SIGSTOP);
+                limit_job_start(&limits[idx], pid, meta.cpu_limit_ms, meta.wall_limit_ms);
             }
             else
             {
                 perror("fork failed");
+                capture_parent(&capture[idx], false);
+                write_fork_failed(csv, &p[idx], get_time_ms() - scheduler_start);
                 finished[idx] = true;
                 remaining--;
                 continue;
             }
         }
 
-        kill(pids[idx], SIGCONT);
+        pageout_job_resumed(&pageout[idx]);
+        affinity_job_resuming(&affinity[idx], pids[idx]);
+        limit_job_resumed(&limits[idx]);
+        job_signal(pids[idx], SIGCONT);
 
-        uint64_t run_start = get_time_ms();
+        SliceTimer timer;
+        slice_timer_start(&timer, this_quantum);
         int status;
         pid_t res = 0;
 
@@ -393,6 +593,8 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
 
             if (res == pids[idx])
             {
+                limit_job_exited(&limits[idx]);
+                capture_job_exited(&capture[idx]);
                 uint64_t slice_end = get_time_ms() - scheduler_start;
                 cpu_time_used_ms[idx] += (slice_end - slice_start);
 
@@ -400,6 +602,7 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
                        p[idx].command,
                        (unsigned long long)slice_start,
                        (unsigned long long)slice_end);
+                trace_slice(p[idx].command, level[idx], slice_start, slice_end);
 
                 p[idx].completion_time = slice_end;
                 p[idx].finished = WIFEXITED(status);
@@ -421,7 +624,7 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
                 fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
                         p[idx].command,
                         p[idx].finished ? "Yes" : "No",
-                        p[idx].error ? "Yes" : "No",
+                        limit_error_field(&limits[idx], p[idx].error),
                         (unsigned long long)p[idx].completion_time,
                         (unsigned long long)p[idx].turnaround_time,
                         (unsigned long long)p[idx].waiting_time,
@@ -431,10 +634,25 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
                 break; 
             }
 
-            uint64_t elapsed = get_time_ms() - run_start;
-            if (elapsed >= (uint64_t)this_quantum)
+            slice_timer_wait(&timer);
+            limits_poll();
+            capture_drain_all();
+            int hint_ms = 0;
+            bool yielded = yield_doorbell_enabled && yield_requested(pids[idx], &hint_ms);
+            if (yielded || slice_timer_expired(&timer))
             {
-                kill(pids[idx], SIGSTOP);
+                job_signal(pids[idx], SIGSTOP);
+                if (yielded)
+                {
+                    yield_stopped(hint_ms);
+                }
+                else
+                {
+                    slice_timer_stopped(&timer);
+                }
+                limit_job_stopped(&limits[idx]);
+                affinity_job_stopped(&affinity[idx], pids[idx]);
+                pageout_job_stopped(&pageout[idx], pids[idx]);
                 uint64_t slice_end = get_time_ms() - scheduler_start;
                 cpu_time_used_ms[idx] += (slice_end - slice_start);
 
@@ -442,44 +660,566 @@ void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int
                        p[idx].command,
                        (unsigned long long)slice_start,
                        (unsigned long long)slice_end);
+                trace_slice(p[idx].command, level[idx], slice_start, slice_end);
+                trace_preempt(p[idx].command, slice_end);
 
-                if (this_quantum == quantum0)
+                if (yielded)
                 {
-                    enque(q1, &f1, &r1, idx);
+                    if (hint_ms > 0)
+                    {
+                        level[idx] = lq_level_for_burst(&lq, quanta, hint_ms);
+                    }
                 }
-                else
+                else if (level[idx] < levels - 1)
                 {
-                    enque(q2, &f2, &r2, idx);
+                    level[idx]++;
+                    trace_demote(p[idx].command, level[idx], slice_end);
                 }
+                lq_push(&lq, level[idx], idx);
 
                 break;
             }
         }
 
+        while (parked_count > 0)
+        {
+            int id = parked[--parked_count];
+            lq_push_front(&lq, level[id], id);
+        }
+        pageout_scan(pageout, pids, finished, n);
+
         uint64_t current_time = get_time_ms() - scheduler_start;
         while (boostTime > 0 && current_time >= next_boost_time)
         {
-            int id;
-            while (true)
+            trace_boost(current_time);
+            for (int l = lq_next_level(&lq, 1); l != -1; l = lq_next_level(&lq, l))
+            {
+                int id;
+                while ((id = lq_pop(&lq, l)) != -1)
+                {
+                    level[id] = 0;
+                    lq_push(&lq, 0, id);
+                }
+            }
+            next_boost_time += boostTime;
+        }
+    }
+
+    limits_end();
+    precision_end();
+    yield_end();
+    capture_end();
+    pageout_report();
+    affinity_report();
+    lq_free(&lq);
+    trace_end();
+    fclose(csv);
+}
+
+// ############################################################
+#define NICE_0_WEIGHT 1024
+
+// Load weight per nice level (-20..19), each step is ~10% CPU.
+const int nice_to_weight[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906,
+    3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423,
+    335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45,
+    36, 29, 23, 18, 15,
+};
+
+// Always runs the job with the smallest weighted virtual runtime. A job's
+// slice is its weight's share of target_latency (never below
+// min_granularity), and vruntime advances by the measured slice length
+// scaled by NICE_0_WEIGHT / weight. Jobs may carry an "@nice=N" prefix.
+void CompletelyFair(Process p[], int n, int target_latency, int min_granularity)
+{
+    uint64_t scheduler_start = get_time_ms();
+
+    VruntimeHeap heap;
+    if (n <= 0 || vheap_init(&heap, n) < 0)
+    {
+        return;
+    }
+
+    FILE *csv = fopen("result_offline_CFS_output.csv", "w");
+    trace_begin("offline CFS");
+    limits_begin();
+    precision_begin();
+    yield_begin();
+    yield_arm();
+
+    pid_t *pids = calloc(n, sizeof(pid_t));
+    bool *started = calloc(n, sizeof(bool));
+    AffinityState *affinity = calloc(n, sizeof(AffinityState));
+    JobLimit *limits = calloc(n, sizeof(JobLimit));
+    CaptureState *capture = calloc(n, sizeof(CaptureState));
+    uint64_t *cpu_limit_ms = calloc(n, sizeof(uint64_t));
+    uint64_t *wall_limit_ms = calloc(n, sizeof(uint64_t));
+    int *weight = calloc(n, sizeof(int));
+    uint64_t *vruntime = calloc(n, sizeof(uint64_t));
+    uint64_t *cpu_time_used_us = calloc(n, sizeof(uint64_t));
+
+    uint64_t total_weight = 0;
+    for (int i = 0; i < n; i++)
+    {
+        JobMeta meta;
+        strip_job_meta(p[i].command, &meta);
+        weight[i] = nice_to_weight[meta.nice + 20];
+        cpu_limit_ms[i] = meta.cpu_limit_ms;
+        wall_limit_ms[i] = meta.wall_limit_ms;
+        total_weight += weight[i];
+        vheap_push(&heap, i, 0);
+    }
+
+    while (!vheap_empty(&heap))
+    {
+        int idx = vheap_pop(&heap);
+
+        uint64_t slice_ms = (uint64_t)target_latency * weight[idx] / total_weight;
+        if (slice_ms < (uint64_t)min_granularity)
+        {
+            slice_ms = min_granularity;
+        }
+
+        uint64_t slice_start = get_time_ms() - scheduler_start;
+
+        if (!started[idx])
+        {
+            started[idx] = true;
+            p[idx].started = true;
+            p[idx].start_time = slice_start;
+
+            capture_prepare(&capture[idx], idx);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                char cmd_copy[1000];
+                strncpy(cmd_copy, p[idx].command, sizeof(cmd_copy) - 1);
+                cmd_copy[sizeof(cmd_copy) - 1] = '\0';
+                char **argv = parse_command(cmd_copy);
+                capture_child(&capture[idx]);
+                precision_child();
+                gang_exec_pipeline(p[idx].command);
+                execvp(argv[0], argv);
+                perror("execvp failed");
+                _exit(EXIT_FAILURE);
+            }
+            else if (pid > 0)
+            {
+                gang_parent(pid, p[idx].command);
+                capture_parent(&capture[idx], true);
+                p[idx].process_id = pid;
+                pids[idx] = pid;
+                job_signal(pid, SIGSTOP);
+                limit_job_start(&limits[idx], pid, cpu_limit_ms[idx], wall_limit_ms[idx]);
+            }
+            else
+            {
+                perror("fork failed");
+                capture_parent(&capture[idx], false);
+                write_fork_failed(csv, &p[idx], get_time_ms() - scheduler_start);
+                total_weight -= weight[idx];
+                continue;
+            }
+        }
+
+        affinity_job_resuming(&affinity[idx], pids[idx]);
+        limit_job_resumed(&limits[idx]);
+        job_signal(pids[idx], SIGCONT);
+
+        SliceTimer timer;
+        slice_timer_start(&timer, slice_ms);
+        uint64_t run_start_us = timer.start_ns / 1000;
+        uint64_t deadline_us = timer.deadline_ns / 1000;
+        int status;
+        bool exited = false;
+
+        while (1)
+        {
+            if (waitpid(pids[idx], &status, WNOHANG) == pids[idx])
+            {
+                limit_job_exited(&limits[idx]);
+                capture_job_exited(&capture[idx]);
+                exited = true;
+                break;
+            }
+            limits_poll();
+            capture_drain_all();
+            uint64_t now_us = mono_time_us();
+            int hint_ms = 0;
+            bool yielded = yield_doorbell_enabled && yield_requested(pids[idx], &hint_ms);
+            if (yielded || now_us >= deadline_us)
+            {
+                job_signal(pids[idx], SIGSTOP);
+                if (yielded)
+                {
+                    yield_stopped(hint_ms);
+                }
+                else
+                {
+                    slice_timer_stopped(&timer);
+                }
+                limit_job_stopped(&limits[idx]);
+                affinity_job_stopped(&affinity[idx], pids[idx]);
+                break;
+            }
+            if (precision_mode)
             {
-                id = deque(q1, &f1, &r1);
-                if (id == -1)
-                    break;
+                slice_timer_wait(&timer);
+                continue;
+            }
+            uint64_t wait_us = deadline_us - now_us;
+            usleep(wait_us < 1000 ? wait_us : 1000);
+        }
+
+        uint64_t ran_us = mono_time_us() - run_start_us;
+        uint64_t slice_end = get_time_ms() - scheduler_start;
+        cpu_time_used_us[idx] += ran_us;
+        vruntime[idx] += ran_us * NICE_0_WEIGHT / weight[idx];
+
+        printf("%s, %llu, %llu\n",
+               p[idx].command,
+               (unsigned long long)slice_start,
+               (unsigned long long)slice_end);
+        trace_slice(p[idx].command, -1, slice_start, slice_end);
+
+        if (exited)
+        {
+            p[idx].completion_time = slice_end;
+            p[idx].finished = WIFEXITED(status);
+            p[idx].error = !p[idx].finished || (WEXITSTATUS(status) != 0);
+            total_weight -= weight[idx];
+
+            uint64_t cpu_ms = cpu_time_used_us[idx] / 1000;
+            p[idx].turnaround_time = p[idx].completion_time;
+            p[idx].waiting_time = p[idx].turnaround_time > cpu_ms ? p[idx].turnaround_time - cpu_ms : 0;
+            p[idx].response_time = p[idx].start_time;
+
+            fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
+                    p[idx].command,
+                    p[idx].finished ? "Yes" : "No",
+                    limit_error_field(&limits[idx], p[idx].error),
+                    (unsigned long long)p[idx].completion_time,
+                    (unsigned long long)p[idx].turnaround_time,
+                    (unsigned long long)p[idx].waiting_time,
+                    (unsigned long long)p[idx].response_time);
+            fflush(csv);
+        }
+        else
+        {
+            trace_preempt(p[idx].command, slice_end);
+            vheap_push(&heap, idx, vruntime[idx]);
+        }
+    }
+
+    vheap_free(&heap);
+    free(pids);
+    free(started);
+    free(affinity);
+    capture_end();
+    free(limits);
+    free(capture);
+    free(cpu_limit_ms);
+    free(wall_limit_ms);
+    free(weight);
+    free(vruntime);
+    free(cpu_time_used_us);
+    limits_end();
+    precision_end();
+    yield_end();
+    affinity_report();
+    trace_end();
+    fclose(csv);
+}
+
+// Predicted burst of a batch job: its own history from burst_stats_path,
+// else the similar-command model, else the online default.
+double plan_predict(const char *command)
+{
+    double mean = burst_stats_lookup(command);
+    if (mean >= 0.0)
+    {
+        return mean;
+    }
+    BurstFeatures f;
+    burst_features(command, &f);
+    return burst_model_predict(&f);
+}
+
+// With burst_model_enabled, fits the similar-command model to the loaded
+// history so plan_predict() can use it for commands that have none.
+void plan_seed_model()
+{
+    if (!burst_model_enabled)
+    {
+        return;
+    }
+    for (int i = 0; i < burst_stats_count; i++)
+    {
+        BurstFeatures f;
+        burst_features(burst_stats[i].command, &f);
+        burst_model_observe(&f, burst_stats[i].mean_ms, true);
+    }
+}
 
-                enque(q0, &f0, &r0, id);
+// List-schedules order[] onto cores using the predicted bursts; fills
+// completion[] and returns the makespan.
+double plan_simulate(const int order[], int n, const double predicted[], int cores, double completion[])
+{
+    double core_free[MAX_PROCS] = {0};
+    double makespan = 0.0;
+    for (int k = 0; k < n; k++)
+    {
+        int c = 0;
+        for (int j = 1; j < cores; j++)
+        {
+            if (core_free[j] < core_free[c])
+            {
+                c = j;
             }
+        }
+        core_free[c] += predicted[order[k]];
+        completion[order[k]] = core_free[c];
+        if (core_free[c] > makespan)
+        {
+            makespan = core_free[c];
+        }
+    }
+    return makespan;
+}
 
-            while (true)
+// Mean of the entries that are >= 0; a negative entry is a job that never
+// ran.
+double plan_mean(const double v[], int n)
+{
+    double sum = 0.0;
+    int used = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (v[i] >= 0.0)
+        {
+            sum += v[i];
+            used++;
+        }
+    }
+    return used > 0 ? sum / used : 0.0;
+}
+
+// Reaps one of the plan's own jobs that has exited and returns its index,
+// or -1. Other children of the process are left to whoever started them.
+int plan_reap(const pid_t pids[], int n, int *status)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (pids[i] > 0 && waitpid(pids[i], status, WNOHANG) == pids[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Runs the batch in a planned order, up to cores jobs at a time: shortest
+// predicted job first on one core (mean completion), longest first on
+// several (makespan).
+void HistoryPlan(Process p[], int n, int cores)
+{
+    uint64_t scheduler_start = get_time_ms();
+    if (n > MAX_PROCS)
+    {
+        fprintf(stderr, "history plan: at most %d jobs\n", MAX_PROCS);
+        return;
+    }
+    cores = cores < 1 ? 1 : (cores > MAX_PROCS ? MAX_PROCS : cores);
+    if (burst_stats_path != NULL && burst_stats_load(burst_stats_path) < 0)
+    {
+        perror("burst stats");
+    }
+
+    JobMeta meta[MAX_PROCS];
+    double predicted[MAX_PROCS] = {0};
+    int input_order[MAX_PROCS] = {0};
+    int order[MAX_PROCS] = {0};
+    int known = 0;
+    plan_seed_model();
+    for (int i = 0; i < n; i++)
+    {
+        strip_job_meta(p[i].command, &meta[i]);
+        known += burst_stats_lookup(p[i].command) >= 0.0;
+        predicted[i] = plan_predict(p[i].command);
+        input_order[i] = i;
+    }
+
+    // Insertion sort keeps input order among equal predictions.
+    bool lpt = cores > 1;
+    for (int k = 0; k < n; k++)
+    {
+        int j = k;
+        while (j > 0 && (lpt ? predicted[order[j - 1]] < predicted[k] : predicted[order[j - 1]] > predicted[k]))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = k;
+    }
+
+    double completion[MAX_PROCS];
+    double fifo_makespan = plan_simulate(input_order, n, predicted, cores, completion);
+    double fifo_mean = plan_mean(completion, n);
+    double plan_makespan = plan_simulate(order, n, predicted, cores, completion);
+    double plan_mean_completion = plan_mean(completion, n);
+
+    FILE *csv = fopen("result_offline_PLAN_output.csv", "w");
+    trace_begin(lpt ? "offline LPT" : "offline SJF");
+    limits_begin();
+
+    pid_t pids[MAX_PROCS] = {0};
+    JobLimit limits[MAX_PROCS];
+    CaptureState capture[MAX_PROCS];
+    double actual[MAX_PROCS];
+    int slot[MAX_PROCS] = {0};
+    bool slot_busy[MAX_PROCS] = {0};
+    int next = 0;
+    int running = 0;
+    int done = 0;
+    int fork_failed = 0;
+    for (int i = 0; i < n; i++)
+    {
+        actual[i] = -1.0;
+    }
+
+    while (done < n)
+    {
+        while (running < cores && next < n)
+        {
+            int i = order[next++];
+            p[i].started = true;
+            p[i].start_time = get_time_ms() - scheduler_start;
+
+            capture_prepare(&capture[i], i);
+            int pid = fork();
+            if (pid == 0)
             {
-                id = deque(q2, &f2, &r2);
-                if (id == -1)
-                    break;
+                char cmd_copy[1000];
+                strncpy(cmd_copy, p[i].command, sizeof(cmd_copy) - 1);
+                cmd_copy[sizeof(cmd_copy) - 1] = '\0';
+                char **argv = parse_command(cmd_copy);
+                capture_child(&capture[i]);
+                precision_child();
+                gang_exec_pipeline(p[i].command);
+                execvp(argv[0], argv);
+                perror("execvp failed");
+                _exit(EXIT_FAILURE);
+            }
+            else if (pid > 0)
+            {
+                gang_parent(pid, p[i].command);
+                capture_parent(&capture[i], true);
+                limit_job_start(&limits[i], pid, meta[i].cpu_limit_ms, meta[i].wall_limit_ms);
+                limit_job_resumed(&limits[i]);
+                pids[i] = pid;
+                running++;
+                while (slot_busy[slot[i]])
+                {
+                    slot[i]++;
+                }
+                slot_busy[slot[i]] = true;
+            }
+            else
+            {
+                perror("fork failed");
+                capture_parent(&capture[i], false);
+                write_fork_failed(csv, &p[i], p[i].start_time);
+                fork_failed++;
+                done++;
+            }
+        }
+        if (running == 0)
+        {
+            continue;
+        }
 
-                enque(q0, &f0, &r0, id);
+        int status;
+        int i = plan_reap(pids, n, &status);
+        if (i == -1)
+        {
+            // With nothing to poll, block until some child exits without
+            // reaping it. It may not be one of ours, so the sleep below
+            // still bounds the loop.
+            siginfo_t info;
+            if (limit_wheel.count == 0 && capture_live_count == 0 &&
+                waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) == 0)
+            {
+                i = plan_reap(pids, n, &status);
             }
-            next_boost_time += boostTime;
+            if (i == -1)
+            {
+                limits_poll();
+                capture_poll(1);
+                continue;
+            }
+        }
+        pids[i] = 0;
+        running--;
+        done++;
+        slot_busy[slot[i]] = false;
+        limit_job_exited(&limits[i]);
+        capture_job_exited(&capture[i]);
+
+        p[i].completion_time = get_time_ms() - scheduler_start;
+        p[i].finished = WIFEXITED(status);
+        p[i].error = !p[i].finished || (WEXITSTATUS(status) != 0);
+        p[i].turnaround_time = p[i].completion_time;
+        p[i].waiting_time = p[i].start_time;
+        p[i].response_time = p[i].start_time;
+        actual[i] = (double)p[i].completion_time;
+
+        printf("%s, %llu, %llu\n",
+               p[i].command,
+               (unsigned long long)p[i].start_time,
+               (unsigned long long)p[i].completion_time);
+        trace_slot_slice(p[i].command, slot[i], p[i].start_time, p[i].completion_time);
+
+        fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
+                p[i].command,
+                p[i].finished ? "Yes" : "No",
+                limit_error_field(&limits[i], p[i].error),
+                (unsigned long long)p[i].completion_time,
+                (unsigned long long)p[i].turnaround_time,
+                (unsigned long long)p[i].waiting_time,
+                (unsigned long long)p[i].response_time);
+        fflush(csv);
+    }
+
+    double actual_makespan = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        if (actual[i] > actual_makespan)
+        {
+            actual_makespan = actual[i];
         }
     }
+    if (fork_failed > 0)
+    {
+        printf("\n%d job%s could not be forked and %s left out of the actual mean.\n",
+               fork_failed, fork_failed > 1 ? "s" : "", fork_failed > 1 ? "are" : "is");
+    }
 
+    printf("\nPlan (%d of %d jobs with history, %d core%s):\n", known, n, cores, cores > 1 ? "s" : "");
+    printf("  %-22s %16s %12s\n", "", "mean completion", "makespan");
+    printf("  %-22s %13.0f ms %9.0f ms\n", "input order, predicted", fifo_mean, fifo_makespan);
+    printf("  %-22s %13.0f ms %9.0f ms\n", lpt ? "LPT, predicted" : "SJF, predicted",
+           plan_mean_completion, plan_makespan);
+    printf("  %-22s %13.0f ms %9.0f ms\n", lpt ? "LPT, actual" : "SJF, actual",
+           plan_mean(actual, n), actual_makespan);
+
+    limits_end();
+    capture_end();
+    trace_end();
+    burst_stats_clear();
     fclose(csv);
 }
\ No newline at end of file
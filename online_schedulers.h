@@ -1,4 +1,7 @@
 #pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,12 +16,38 @@
 #include <ctype.h>
 #include <errno.h>
 
+#include "utils/submit_queue.h"
+#include "utils/admission.h"
+#include "utils/pageout.h"
+#include "utils/affinity.h"
+#include "utils/perf_counters.h"
+#include "utils/level_queue.h"
+#include "utils/trace.h"
+#include "utils/shared_queue.h"
+#include "utils/job_meta.h"
+#include "utils/tenant.h"
+#include "utils/burst_model.h"
+#include "utils/burst_stats.h"
+#include "utils/gang.h"
+#include "utils/job_limits.h"
+#include "utils/precision.h"
+#include "utils/yield_doorbell.h"
+#include "utils/prefetch.h"
+#include "utils/output_capture.h"
+
 // ------------------ CONSTANTS ------------------
 #define MAX_HIST 50
 #define READ_BUF 4096
+#ifndef MAX_PROCS
 #define MAX_PROCS 100
+#endif
+#ifndef MAX_CMDS
 #define MAX_CMDS 50
+#endif
+#ifndef MAX_QUEUE
 #define MAX_QUEUE 100
+#endif
+#define BURST_HINT_WEIGHT 0.5
 
 typedef struct
 {
@@ -34,15 +63,29 @@ typedef struct
     int process_id;
     double est_burst;
     uint64_t arrival_time;
+    int job_id;
+    int shm_slot;
+    int tenant;
+    uint64_t cpu_limit_ms;
+    uint64_t wall_limit_ms;
+    BurstFeatures features;
 
 } Process;
 
 int terminate_flag = 0;
+const char *submit_socket_path = NULL;
+int shm_claim_limit = 2;
+bool shm_claims_stopped = false;
+bool arrival_preemption = true;
 char *cmd_history[MAX_CMDS] = {0};
 double burst_hist[MAX_CMDS][MAX_HIST];
 int total_cmds = 0;
 double burst_sum[MAX_CMDS] = {0.0};
 int burst_count[MAX_CMDS] = {0};
+BurstFeatures cmd_features[MAX_CMDS];
+// Burst hints from yielding jobs, kept apart from the measured history.
+double burst_hint_sum[MAX_CMDS] = {0.0};
+int burst_hint_count[MAX_CMDS] = {0};
 
 uint64_t get_time_ms()
 {
@@ -105,16 +148,21 @@ int find_cmd_index(const char *cmd)
     return -1;
 }
 
-void register_burst_global(int idx, double burst, bool error)
+// Returns the command's history index, adding it when there is room.
+int add_cmd_history(const char *cmd)
 {
-    if (idx < 0 || error)
+    int idx = find_cmd_index(cmd);
+    if (idx == -1 && total_cmds < MAX_CMDS)
     {
-        return;
+        cmd_history[total_cmds] = strdup(cmd);
+        if (burst_model_enabled)
+        {
+            burst_features(cmd, &cmd_features[total_cmds]);
+        }
+        idx = total_cmds;
+        total_cmds++;
     }
-    int pos = burst_count[idx] % MAX_HIST;
-    burst_hist[idx][pos] = burst;
-    burst_sum[idx] += burst;
-    burst_count[idx]++;
+    return idx;
 }
 
 double avg_burst(int idx)
@@ -123,6 +171,10 @@ double avg_burst(int idx)
     {
         return -1.0;
     }
+    if (shm_segment != NULL && idx < total_cmds)
+    {
+        return shm_burst_estimate(cmd_history[idx], 0);
+    }
     if (idx >= total_cmds || burst_count[idx] == 0)
     {
         return -1.0;
@@ -131,16 +183,99 @@ double avg_burst(int idx)
     return avg;
 }
 
+void register_burst_global(int idx, double burst, bool error)
+{
+    if (idx < 0 || error)
+    {
+        return;
+    }
+    burst_model_observe(&cmd_features[idx], burst, avg_burst(idx) >= 0.0);
+    // The local history is kept in shared mode too, so save_burst_stats()
+    // merges only what this instance measured.
+    if (shm_segment != NULL)
+    {
+        shm_burst_register(cmd_history[idx], burst);
+    }
+    int pos = burst_count[idx] % MAX_HIST;
+    burst_hist[idx][pos] = burst;
+    burst_sum[idx] += burst;
+    burst_count[idx]++;
+}
+
+void register_burst_hint(int idx, int hint_ms)
+{
+    if (idx < 0 || idx >= total_cmds || hint_ms <= 0)
+    {
+        return;
+    }
+    burst_hint_sum[idx] += hint_ms;
+    burst_hint_count[idx]++;
+}
+
+// The mean hint acts as a prior worth BURST_HINT_WEIGHT measured samples:
+// it stands alone until the command has measured bursts and only nudges the
+// estimate after that. measured < 0 means there are none.
+double with_burst_hint(int idx, double measured, int samples)
+{
+    if (idx < 0 || idx >= total_cmds || burst_hint_count[idx] == 0)
+    {
+        return measured;
+    }
+    double hint = burst_hint_sum[idx] / burst_hint_count[idx];
+    if (measured < 0.0)
+    {
+        return hint;
+    }
+    if (samples < 1)
+    {
+        samples = 1;
+    }
+    return (measured * samples + hint * BURST_HINT_WEIGHT) / (samples + BURST_HINT_WEIGHT);
+}
+
+// Merges this run's per-command means into burst_stats_path for the
+// offline planner.
+void save_burst_stats()
+{
+    if (burst_stats_path == NULL)
+    {
+        return;
+    }
+    burst_stats_load(burst_stats_path);
+    for (int i = 0; i < total_cmds; i++)
+    {
+        if (burst_count[i] > 0)
+        {
+            burst_stats_merge(cmd_history[i], burst_sum[i] / burst_count[i], burst_count[i]);
+        }
+    }
+    if (!burst_stats_save(burst_stats_path))
+    {
+        perror("burst stats");
+    }
+    burst_stats_clear();
+}
+
 double estimate_burst(int idx, int k)
 {
     if (idx < 0)
     {
         return 1000.0;
     }
-    if (idx >= total_cmds || burst_count[idx] == 0)
+    if (shm_segment != NULL && idx < total_cmds)
+    {
+        double shared = with_burst_hint(idx, shm_burst_estimate(cmd_history[idx], k), burst_count[idx]);
+        return shared >= 0.0 ? shared : burst_model_predict(&cmd_features[idx]);
+    }
+    if (idx >= total_cmds)
     {
         return 1000.0;
     }
+    if (burst_count[idx] == 0)
+    {
+        double hinted = with_burst_hint(idx, -1.0, 0);
+        return hinted >= 0.0 ? hinted : burst_model_predict(&cmd_features[idx]);
+    }
     int total = burst_count[idx];
     int start = 0;
     if (total > k)
@@ -156,7 +291,7 @@ double estimate_burst(int idx, int k)
     }
     if (used)
     {
-        return sum / used;
+        return with_burst_hint(idx, sum / used, used);
     }
     else
     {
@@ -164,6 +299,139 @@ double estimate_burst(int idx, int k)
     }
 }
 
+int add_local_arrival(Process p[], int total_procs, const char *line, int job_id, uint64_t arrival_time)
+{
+    JobMeta meta;
+    char *cmd = strdup(line);
+    strip_job_meta(cmd, &meta);
+
+    p[total_procs].command = cmd;
+    p[total_procs].process_id = -1;
+    p[total_procs].waiting_time = 0;
+    p[total_procs].response_time = 0;
+    p[total_procs].finished = false;
+    p[total_procs].error = false;
+    p[total_procs].started = false;
+    p[total_procs].job_id = job_id;
+    p[total_procs].shm_slot = -1;
+    p[total_procs].tenant = tenant_lookup(meta.tenant, meta.share);
+    p[total_procs].cpu_limit_ms = meta.cpu_limit_ms;
+    p[total_procs].wall_limit_ms = meta.wall_limit_ms;
+    tenant_job_added(p[total_procs].tenant);
+
+    p[total_procs].arrival_time = arrival_time;
+    trace_arrival(p[total_procs].command, p[total_procs].arrival_time);
+
+    // A command without a history slot (all MAX_CMDS taken) gets its own
+    // features, so the burst model still covers it.
+    int idx = add_cmd_history(cmd);
+    if (burst_model_enabled)
+    {
+        if (idx >= 0)
+        {
+            p[total_procs].features = cmd_features[idx];
+        }
+        else
+        {
+            burst_features(cmd, &p[total_procs].features);
+        }
+    }
+
+    return total_procs + 1;
+}
+
+// With a shared segment attached, new jobs go to the shared table and reach
+// the process table only once some instance claims them. reserved says the
+// caller already holds a process table slot (socket submissions do).
+int add_arrival(Process p[], int total_procs, const char *cmd, int job_id, uint64_t scheduler_start, bool reserved)
+{
+    if (shm_segment != NULL)
+    {
+        if (reserved)
+        {
+            submit_release_slot();
+        }
+        if (shm_submit(cmd, job_id, get_time_ms()) < 0)
+        {
+            fprintf(stderr, "shared job table full, dropping: %s\n", cmd);
+        }
+        return total_procs;
+    }
+    if (!reserved && !submit_reserve_slot())
+    {
+        fprintf(stderr, "process table full, dropping: %s\n", cmd);
+        return total_procs;
+    }
+    return add_local_arrival(p, total_procs, cmd, job_id, get_time_ms() - scheduler_start);
+}
+
+// Tops this instance up to shm_claim_limit unfinished jobs from the shared
+// table, leaving the rest for the other instances. Process table entries are
+// never reused, so an instance claims at most MAX_PROCS jobs over its life;
+// after that the jobs stay in the table for the other instances.
+int claim_shared_jobs(Process p[], int total_procs, const bool finished[], uint64_t scheduler_start)
+{
+    shm_reap_dead_owners();
+
+    int active = 0;
+    for (int i = 0; i < total_procs; i++)
+    {
+        if (!finished[i])
+        {
+            active++;
+        }
+    }
+
+    char cmd[SHM_CMD_MAX];
+    while (active < shm_claim_limit && total_procs < MAX_PROCS)
+    {
+        int job_id;
+        uint64_t submitted;
+        int slot = shm_claim(cmd, sizeof(cmd), &job_id, &submitted);
+        if (slot < 0)
+        {
+            break;
+        }
+        uint64_t arrival = submitted > scheduler_start ? submitted - scheduler_start : 0;
+        total_procs = add_local_arrival(p, total_procs, cmd, job_id, arrival);
+        p[total_procs - 1].shm_slot = slot;
+        active++;
+    }
+    if (total_procs >= MAX_PROCS && active < shm_claim_limit && !shm_claims_stopped)
+    {
+        shm_claims_stopped = true;
+        fprintf(stderr, "process table full after %d jobs, no longer claiming shared jobs\n", MAX_PROCS);
+    }
+    return total_procs;
+}
+
+void shared_begin()
+{
+    shm_claims_stopped = false;
+    if (shared_segment_name != NULL && shm_attach(shared_segment_name) == 0)
+    {
+        submit_job_seq_ptr = &shm_segment->next_job_id;
+    }
+}
+
+// Unstarted claims go back to the shared table for the other instances.
+void shared_end(Process p[], int total_procs, const pid_t pids[], const bool finished[])
+{
+    if (shm_segment == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < total_procs; i++)
+    {
+        if (p[i].shm_slot >= 0 && !finished[i] && pids[i] == 0)
+        {
+            shm_release(p[i].shm_slot, false);
+        }
+    }
+    submit_job_seq_ptr = &submit_job_seq;
+    shm_detach();
+}
+
 int read_new_arrivals(Process p[], int total_procs, uint64_t schedular_start)
 {
     char *line = NULL;
@@ -182,25 +450,7 @@ int read_new_arrivals(Process p[], int total_procs, uint64_t schedular_start)
             continue;
         }
 
-        p[total_procs].command = strdup(line);
-        p[total_procs].process_id = -1;
-        p[total_procs].waiting_time = 0;
-        p[total_procs].response_time = 0;
-        p[total_procs].finished = false;
-        p[total_procs].error = false;
-        p[total_procs].started = false;
-
-        p[total_procs].arrival_time = get_time_ms() - schedular_start;
-
-        int cmd_idx = find_cmd_index(line);
-
-        if (cmd_idx == -1 && total_cmds < MAX_CMDS)
-        {
-            cmd_history[total_cmds] = strdup(line);
-            cmd_idx = total_cmds;
-            total_cmds++;
-        }
-        total_procs++;
+        total_procs = add_arrival(p, total_procs, line, submit_next_job_id(), schedular_start, false);
     }
 
     free(line);
@@ -230,80 +480,303 @@ int read_all_commands(Process p[], int total_procs, uint64_t scheduler_start)
             cmd++;
         }
 
-        p[total_procs].command = strdup(cmd);
-        p[total_procs].process_id = -1;
-        p[total_procs].waiting_time = 0;
-        p[total_procs].response_time = 0;
-        p[total_procs].finished = false;
-        p[total_procs].error = false;
-        p[total_procs].started = false;
+        total_procs = add_arrival(p, total_procs, cmd, submit_next_job_id(), scheduler_start, false);
+    }
 
-        p[total_procs].arrival_time = get_time_ms() - scheduler_start;
+    return total_procs;
+}
 
-        int cmd_idx = find_cmd_index(cmd);
-        if (cmd_idx == -1 && total_cmds < MAX_CMDS)
+// Moves jobs accepted on the submission socket into the process table. The
+// intake thread reserved a slot for each, so every acknowledged job fits.
+int drain_submissions(Process p[], int total_procs, uint64_t scheduler_start)
+{
+    while (true)
+    {
+        SubmitNode *node = submit_queue_pop(&submit_queue);
+        if (node == NULL)
         {
-            cmd_history[total_cmds] = strdup(cmd);
-            cmd_idx = total_cmds;
-            total_cmds++;
+            break;
         }
+        total_procs = add_arrival(p, total_procs, node->command, node->job_id, scheduler_start, true);
+        free(node->command);
+        free(node);
+    }
+    return total_procs;
+}
 
-        total_procs++;
+// With tenant_fair_share every tenant has its own level queues: the tenant
+// is picked first, then the highest non-empty level within it.
+LevelQueues *mlfq_queues(LevelQueues *lq, Process p[], int idx)
+{
+    if (tenant_fair_share)
+    {
+        LevelQueues *tq = tenant_queues(p[idx].tenant, lq->levels, lq->capacity);
+        if (tq != NULL)
+        {
+            return tq;
+        }
     }
+    return lq;
+}
 
-    return total_procs;
+void mlfq_push(LevelQueues *lq, Process p[], int level, int idx)
+{
+    lq_push(mlfq_queues(lq, p, idx), level, idx);
+}
+
+void mlfq_push_front(LevelQueues *lq, Process p[], int level, int idx)
+{
+    lq_push_front(mlfq_queues(lq, p, idx), level, idx);
+}
+
+bool mlfq_empty(const LevelQueues *lq)
+{
+    if (tenant_fair_share && tenant_next() != -1)
+    {
+        return false;
+    }
+    return lq_empty(lq);
 }
 
-void enque_queue_level(Process p[], int idx,
-                           int q0[], int *f0, int *r0,
-                           int q1[], int *f1, int *r1,
-                           int q2[], int *f2, int *r2,
-                           int quantum0, int quantum1)
+int mlfq_pop(LevelQueues *lq)
+{
+    if (tenant_fair_share)
+    {
+        int t = tenant_next();
+        if (t != -1 && tenants[t].has_queues && !lq_empty(&tenants[t].queues))
+        {
+            return lq_pop_highest(&tenants[t].queues, NULL);
+        }
+    }
+    return lq_pop_highest(lq, NULL);
+}
+
+void mlfq_boost_queues(LevelQueues *lq, int level[])
+{
+    for (int l = lq_next_level(lq, 1); l != -1; l = lq_next_level(lq, l))
+    {
+        int id;
+        while ((id = lq_pop(lq, l)) != -1)
+        {
+            level[id] = 0;
+            lq_push(lq, 0, id);
+        }
+    }
+}
+
+void mlfq_boost(LevelQueues *lq, int level[])
+{
+    mlfq_boost_queues(lq, level);
+    for (int t = 0; tenant_fair_share && t < tenant_count; t++)
+    {
+        if (tenants[t].has_queues)
+        {
+            mlfq_boost_queues(&tenants[t].queues, level);
+        }
+    }
+}
+
+// A job whose fork() failed never ran. It still gets a row, marked
+// ForkFailed, instead of missing from the CSV.
+void write_fork_failed(FILE *csv, Process *p, const PerfCounters *pc, uint64_t now)
+{
+    p->finished = false;
+    p->error = true;
+    p->completion_time = now;
+    p->turnaround_time = now - p->arrival_time;
+    p->waiting_time = p->turnaround_time;
+    p->response_time = p->turnaround_time;
+    fprintf(csv, "%s,No,ForkFailed,%llu,%llu,%llu,%llu",
+            p->command,
+            (unsigned long long)p->completion_time,
+            (unsigned long long)p->turnaround_time,
+            (unsigned long long)p->waiting_time,
+            (unsigned long long)p->response_time);
+    if (tenant_fair_share)
+    {
+        fprintf(csv, ",%s", tenants[p->tenant].name);
+    }
+    perf_csv_columns(csv, pc);
+    fprintf(csv, "\n");
+    fflush(csv);
+}
+
+// Picks the first level whose quantum covers the command's average burst.
+// Commands without history start in the middle level unless the burst model
+// can place them.
+void enque_queue_level(Process p[], int idx, LevelQueues *lq, int level[], const int quanta[])
 {
     char *cmd = p[idx].command;
     int cmd_idx = find_cmd_index(cmd);
     double avg = -1.0;
     if (cmd_idx != -1)
     {
-        avg = avg_burst(cmd_idx);
+        avg = with_burst_hint(cmd_idx, avg_burst(cmd_idx), burst_count[cmd_idx]);
+    }
+    int source;
+    if (avg < 0.0 && burst_model_enabled)
+    {
+        avg = burst_model_predict_from(&p[idx].features, &source);
+        if (source == BURST_FROM_DEFAULT)
+        {
+            avg = -1.0;
+        }
     }
 
+    int target = lq->levels / 2;
     if (avg >= 0.0)
     {
-        if (avg < (double)quantum0)
+        target = lq_level_for_burst(lq, quanta, avg);
+    }
+    level[idx] = target;
+    mlfq_push(lq, p, target, idx);
+}
+
+int poll_arrivals(Process p[], int total_procs, const bool finished[], bool interactive, uint64_t scheduler_start)
+{
+    if (interactive)
+    {
+        total_procs = read_new_arrivals(p, total_procs, scheduler_start);
+    }
+    if (submit_socket_path != NULL)
+    {
+        total_procs = drain_submissions(p, total_procs, scheduler_start);
+    }
+    if (shm_segment != NULL)
+    {
+        total_procs = claim_shared_jobs(p, total_procs, finished, scheduler_start);
+    }
+    return total_procs;
+}
+
+// Queues every job that has not been queued yet and returns the highest
+// priority (lowest) level any of them went to, or lq->levels if none.
+int enque_new_arrivals(Process p[], int total_procs, bool started[], const bool finished[],
+                       LevelQueues *lq, int level[], const int quanta[])
+{
+    int best = lq->levels;
+    for (int i = 0; i < total_procs; i++)
+    {
+        if (!started[i] && !finished[i])
         {
-            enque(q0, f0, r0, idx);
+            enque_queue_level(p, i, lq, level, quanta);
+            started[i] = true;
+            if (level[i] < best)
+            {
+                best = level[i];
+            }
         }
-        else if (avg < (double)quantum1)
+    }
+    return best;
+}
+
+// Hints the next prefetch_depth unstarted jobs in dispatch order.
+void prefetch_upcoming_mlfq(Process p[], LevelQueues *lq, const pid_t pids[], bool hinted[])
+{
+    if (tenant_fair_share)
+    {
+        int t = tenant_next();
+        if (t != -1 && tenants[t].has_queues)
         {
-            enque(q1, f1, r1, idx);
+            lq = &tenants[t].queues;
         }
-        else
+    }
+    int budget = prefetch_depth;
+    int scan = 4 * prefetch_depth;
+    for (int l = lq_next_level(lq, 0); l != -1 && budget > 0 && scan > 0; l = lq_next_level(lq, l + 1))
+    {
+        int id;
+        for (int pos = 0; budget > 0 && scan > 0 && (id = lq_at(lq, l, pos)) != -1; pos++, scan--)
         {
-            enque(q2, f2, r2, idx);
+            if (pids[id] != 0)
+            {
+                continue;
+            }
+            if (!hinted[id])
+            {
+                prefetch_hint(p[id].command);
+                hinted[id] = true;
+            }
+            budget--;
         }
     }
-    else
+}
+
+void prefetch_upcoming_sjf(Process p[], const bool finished[], int total_procs, int running, bool hinted[])
+{
+    for (int d = 0; d < prefetch_depth; d++)
     {
-        enque(q1, f1, r1, idx);
+        int best = -1;
+        for (int i = 0; i < total_procs; i++)
+        {
+            if (i != running && !finished[i] && !p[i].started && !hinted[i] &&
+                (best == -1 || p[i].est_burst < p[best].est_burst))
+            {
+                best = i;
+            }
+        }
+        if (best == -1)
+        {
+            return;
+        }
+        prefetch_hint(p[best].command);
+        hinted[best] = true;
     }
 }
 
+void MultiLevelFeedbackQueueN(int levels, const int quanta[], int boostTime);
+
 void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boostTime)
+{
+    int quanta[3] = {quantum0, quantum1, quantum2};
+    MultiLevelFeedbackQueueN(3, quanta, boostTime);
+}
+
+// quanta[l] is the time slice of level l; level 0 has the highest priority.
+void MultiLevelFeedbackQueueN(int levels, const int quanta[], int boostTime)
 {
     uint64_t scheduler_start = get_time_ms();
+
+    LevelQueues lq;
+    if (lq_init(&lq, levels, MAX_PROCS) < 0)
+    {
+        fprintf(stderr, "invalid MLFQ level count: %d\n", levels);
+        return;
+    }
+
     FILE *csv = fopen("result_online_MLFQ_output.csv", "w");
+    perf_slices_begin("result_online_MLFQ_perf_slices.csv");
+    trace_begin("online MLFQ");
+    tenant_reset();
+    limits_begin();
+    yield_begin();
+    prefetch_begin();
+    atomic_store(&submit_slots_left, MAX_PROCS);
+    // Attach first: the intake thread takes job ids from the shared counter.
+    shared_begin();
+    if (submit_socket_path != NULL)
+    {
+        submit_start(submit_socket_path);
+    }
     signal(SIGINT, handle_sigint);
     fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
+    precision_begin();
+    yield_arm();
 
     Process procs[MAX_PROCS];
     pid_t pids[MAX_PROCS] = {0};
     bool started[MAX_PROCS] = {0};
     bool finished[MAX_PROCS] = {0};
     uint64_t cpu_time_used_ms[MAX_PROCS] = {0};
-
-    int q0[MAX_QUEUE], q1[MAX_QUEUE], q2[MAX_QUEUE];
-    int f0 = 0, r0 = 0, f1 = 0, r1 = 0, f2 = 0, r2 = 0;
+    PageoutState pageout[MAX_PROCS] = {0};
+    AffinityState affinity[MAX_PROCS] = {0};
+    PerfCounters perf[MAX_PROCS] = {0};
+    JobLimit limits[MAX_PROCS];
+    ExecProbe probe[MAX_PROCS];
+    CaptureState capture[MAX_PROCS];
+    bool hinted[MAX_PROCS] = {0};
+    int level[MAX_PROCS] = {0};
+    int slice_left[MAX_PROCS] = {0};
 
     int total_procs = 0;
     uint64_t next_boost_time = boostTime;
@@ -318,48 +791,62 @@ void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boost
         total_procs = read_all_commands(procs, total_procs, scheduler_start);
     }
 
+    int parked[MAX_PROCS];
+    int parked_count = 0;
+
     while (!terminate_flag)
     {
-        if (interactive)
+        total_procs = poll_arrivals(procs, total_procs, finished, interactive, scheduler_start);
+        enque_new_arrivals(procs, total_procs, started, finished, &lq, level, quanta);
+        limits_poll();
+        if (prefetch_enabled)
         {
-            total_procs = read_new_arrivals(procs, total_procs, scheduler_start);
+            prefetch_upcoming_mlfq(procs, &lq, pids, hinted);
         }
 
-        for (int i = 0; i < total_procs; i++)
+        if (mlfq_empty(&lq) && parked_count > 0)
         {
-            if (!started[i] && !finished[i])
+            while (parked_count > 0)
             {
-                enque_queue_level(procs, i, q0, &f0, &r0, q1, &f1, &r1, q2, &f2, &r2, quantum0, quantum1);
-                started[i] = true;
+                int id = parked[--parked_count];
+                mlfq_push_front(&lq, procs, level[id], id);
             }
         }
-
-        if (f0 == r0 && f1 == r1 && f2 == r2)
+        if (mlfq_empty(&lq))
         {
-            usleep(1000);
+            capture_poll(1);
             continue;
         }
 
-        int idx = -1;
-        int this_quantum = 0;
-        if (f0 != r0)
+        int idx = mlfq_pop(&lq);
+
+        if (idx == -1)
         {
-            idx = deque(q0, &f0, &r0);
-            this_quantum = quantum0;
+            // Nothing dispatchable is queued: the deferred jobs go back in
+            // so they are tried again once admission opens.
+            while (parked_count > 0)
+            {
+                int id = parked[--parked_count];
+                mlfq_push_front(&lq, procs, level[id], id);
+            }
+            capture_poll(1);
+            continue;
         }
-        else if (f1 != r1)
+        if (finished[idx])
         {
-            idx = deque(q1, &f1, &r1);
-            this_quantum = quantum1;
+            continue;
         }
-        else if (f2 != r2)
+        int this_quantum = quanta[level[idx]];
+        if (slice_left[idx] > 0)
         {
-            idx = deque(q2, &f2, &r2);
-            this_quantum = quantum2;
+            this_quantum = slice_left[idx];
         }
 
-        if (idx == -1 || finished[idx])
+        // A deferred job sits out until the next slice ends, so an admitted
+        // job gets the CPU instead of the same job being picked again.
+        if (pids[idx] == 0 && !admission_open(pids, finished, total_procs))
         {
+            parked[parked_count++] = idx;
             continue;
         }
 
@@ -368,6 +855,9 @@ void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boost
         if (pids[idx] == 0)
         {
             procs[idx].start_time = slice_start;
+            int probe_fds[2];
+            capture_prepare(&capture[idx], procs[idx].job_id);
+            exec_probe_pipe(probe_fds, procs[idx].command);
             pid_t pid = fork();
 
             if (pid == 0)
@@ -377,27 +867,48 @@ void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boost
                 strncpy(cmd_copy, procs[idx].command, sizeof(cmd_copy) - 1);
                 cmd_copy[sizeof(cmd_copy) - 1] = '\0';
                 char **argv = parse_command(cmd_copy);
+                capture_child(&capture[idx]);
+                precision_child();
+                gang_exec_pipeline(procs[idx].command);
                 execvp(argv[0], argv);
                 perror("execvp failed");
+                exec_probe_failed(probe_fds);
                 _exit(EXIT_FAILURE);
             }
             else if (pid > 0)
             {
+                gang_parent(pid, procs[idx].command);
+                exec_probe_parent(&probe[idx], probe_fds, hinted[idx]);
+                capture_parent(&capture[idx], true);
                 pids[idx] = pid;
                 procs[idx].process_id = pid;
-                kill(pid, SIGSTOP);
+                shm_job_started(procs[idx].shm_slot, pid);
+                job_signal(pid, SIGSTOP);
+                perf_open_job(&perf[idx], pid);
+                limit_job_start(&limits[idx], pid, procs[idx].cpu_limit_ms, procs[idx].wall_limit_ms);
             }
             else
             {
                 perror("fork failed");
+                exec_probe_abandon(probe_fds);
+                capture_parent(&capture[idx], false);
+                write_fork_failed(csv, &procs[idx], &perf[idx], get_time_ms() - scheduler_start);
                 finished[idx] = true;
+                shm_release(procs[idx].shm_slot, true);
+                tenant_job_done(procs[idx].tenant);
                 continue;
             }
         }
 
-        kill(pids[idx], SIGCONT);
+        pageout_job_resumed(&pageout[idx]);
+        affinity_job_resuming(&affinity[idx], pids[idx]);
+        limit_job_resumed(&limits[idx]);
+        job_signal(pids[idx], SIGCONT);
 
         uint64_t run_start = get_time_ms();
+        SliceTimer timer;
+        slice_timer_start(&timer, this_quantum);
+        slice_left[idx] = 0;
         int status;
         pid_t res = 0;
 
@@ -407,19 +918,27 @@ void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boost
 
             if (res == pids[idx])
             {
+                limit_job_exited(&limits[idx]);
+                capture_job_exited(&capture[idx]);
+                exec_probe_poll(&probe[idx]);
                 uint64_t slice_end = get_time_ms() - scheduler_start;
                 cpu_time_used_ms[idx] += (slice_end - slice_start);
+                tenant_charge(procs[idx].tenant, slice_end - slice_start);
+                perf_read_job(&perf[idx]);
 
                 printf("%s, %llu, %llu\n",
                        procs[idx].command,
                        (unsigned long long)slice_start,
                        (unsigned long long)slice_end);
                 fflush(stdout);
+                trace_slice(procs[idx].command, level[idx], slice_start, slice_end);
+                perf_slice_row(procs[idx].command, &perf[idx], slice_start, slice_end);
 
                 procs[idx].completion_time = slice_end;
                 procs[idx].finished = WIFEXITED(status);
                 procs[idx].error = !procs[idx].finished || WEXITSTATUS(status) != 0;
                 finished[idx] = true;
+                shm_release(procs[idx].shm_slot, true);
 
                 procs[idx].turnaround_time = procs[idx].completion_time - procs[idx].arrival_time;
 
@@ -439,72 +958,168 @@ void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boost
                 {
                     procs[idx].response_time = 0;
                 }
+                tenant_record(procs[idx].tenant, procs[idx].turnaround_time, procs[idx].response_time);
+                tenant_job_done(procs[idx].tenant);
 
-                fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
+                fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu",
                         procs[idx].command,
                         procs[idx].finished ? "Yes" : "No",
-                        procs[idx].error ? "Yes" : "No",
+                        limit_error_field(&limits[idx], procs[idx].error),
                         (unsigned long long)procs[idx].completion_time,
                         (unsigned long long)procs[idx].turnaround_time,
                         (unsigned long long)procs[idx].waiting_time,
                         (unsigned long long)procs[idx].response_time);
+                if (tenant_fair_share)
+                {
+                    fprintf(csv, ",%s", tenants[procs[idx].tenant].name);
+                }
+                perf_csv_columns(csv, &perf[idx]);
+                fprintf(csv, "\n");
 
                 fflush(csv);
 
                 if (!procs[idx].error)
                 {
                     int cmd_idx = find_cmd_index(procs[idx].command);
+                    double burst = (double)(slice_end - slice_start);
+                    double cpu_ms = perf_task_clock_ms(&perf[idx]);
+                    if (cpu_ms >= 0.0)
+                    {
+                        burst = cpu_ms;
+                    }
                     if (cmd_idx != -1)
                     {
-                        double burst = (double)(slice_end - slice_start);
                         register_burst_global(cmd_idx, burst, false);
                     }
+                    else
+                    {
+                        burst_model_observe(&procs[idx].features, burst, false);
+                    }
                 }
+                perf_close_job(&perf[idx]);
                 break;
             }
 
+            slice_timer_wait(&timer);
+            limits_poll();
+            capture_drain_all();
+            exec_probe_poll(&probe[idx]);
             uint64_t elapsed = get_time_ms() - run_start;
 
-            if (elapsed >= (uint64_t)this_quantum)
+            // A new job bound for a higher level than the running one takes
+            // the CPU now; the running job keeps the rest of its slice.
+            bool preempted = false;
+            if (arrival_preemption && level[idx] > 0 && elapsed < (uint64_t)this_quantum)
+            {
+                int known = total_procs;
+                total_procs = poll_arrivals(procs, total_procs, finished, interactive, scheduler_start);
+                if (total_procs > known)
+                {
+                    preempted = enque_new_arrivals(procs, total_procs, started, finished,
+                                                   &lq, level, quanta) < level[idx];
+                }
+            }
+
+            int hint_ms = 0;
+            bool yielded = yield_doorbell_enabled && yield_requested(pids[idx], &hint_ms);
+
+            if (preempted || yielded || slice_timer_expired(&timer))
             {
-                kill(pids[idx], SIGSTOP);
+                job_signal(pids[idx], SIGSTOP);
+                if (yielded)
+                {
+                    yield_stopped(hint_ms);
+                }
+                else if (!preempted)
+                {
+                    slice_timer_stopped(&timer);
+                }
+                limit_job_stopped(&limits[idx]);
+                perf_read_job(&perf[idx]);
+                affinity_job_stopped(&affinity[idx], pids[idx]);
+                pageout_job_stopped(&pageout[idx], pids[idx]);
                 uint64_t slice_end = get_time_ms() - scheduler_start;
                 cpu_time_used_ms[idx] += (slice_end - slice_start);
+                tenant_charge(procs[idx].tenant, slice_end - slice_start);
 
                 printf("%s, %llu, %llu\n",
                        procs[idx].command,
                        (unsigned long long)slice_start,
                        (unsigned long long)slice_end);
                 fflush(stdout);
+                trace_slice(procs[idx].command, level[idx], slice_start, slice_end);
+                trace_preempt(procs[idx].command, slice_end);
+                perf_slice_row(procs[idx].command, &perf[idx], slice_start, slice_end);
 
-                if (this_quantum == quantum0)
+                if (preempted)
                 {
-                    enque(q1, &f1, &r1, idx);
+                    slice_left[idx] = this_quantum - (int)elapsed;
+                    mlfq_push_front(&lq, procs, level[idx], idx);
+                    break;
                 }
-                else
+                if (yielded)
+                {
+                    // Giving the CPU back early keeps the job's level; a
+                    // burst hint picks the level instead and becomes a prior
+                    // for the command's later estimates.
+                    if (hint_ms > 0)
+                    {
+                        level[idx] = lq_level_for_burst(&lq, quanta, hint_ms);
+                        register_burst_hint(find_cmd_index(procs[idx].command), hint_ms);
+                    }
+                    mlfq_push(&lq, procs, level[idx], idx);
+                    break;
+                }
+                if (level[idx] < levels - 1)
                 {
-                    enque(q2, &f2, &r2, idx);
+                    level[idx]++;
+                    trace_demote(procs[idx].command, level[idx], slice_end);
                 }
+                mlfq_push(&lq, procs, level[idx], idx);
 
                 break;
             }
         }
+        while (parked_count > 0)
+        {
+            int id = parked[--parked_count];
+            mlfq_push_front(&lq, procs, level[id], id);
+        }
+        pageout_scan(pageout, pids, finished, total_procs);
+
         uint64_t current_time = get_time_ms() - scheduler_start;
         while (boostTime > 0 && current_time >= next_boost_time)
         {
-            int id;
-            while ((id = deque(q1, &f1, &r1)) != -1)
-            {
-                enque(q0, &f0, &r0, id);
-            }
-            while ((id = deque(q2, &f2, &r2)) != -1)
-            {
-                enque(q0, &f0, &r0, id);
-            }
+            trace_boost(current_time);
+            mlfq_boost(&lq, level);
             next_boost_time += boostTime;
         }
     }
 
+    submit_stop(submit_socket_path);
+    limits_end();
+    yield_end();
+    precision_end();
+    capture_end();
+    prefetch_end();
+    prefetch_report();
+    burst_model_report();
+    save_burst_stats();
+    pageout_report();
+    affinity_report();
+    for (int i = 0; i < total_procs; i++)
+    {
+        perf_close_job(&perf[i]);
+    }
+    perf_slices_end();
+    perf_report();
+    if (tenant_fair_share)
+    {
+        tenant_report("result_online_MLFQ_tenants.csv");
+    }
+    shared_end(procs, total_procs, pids, finished);
+    lq_free(&lq);
+    trace_end();
     fclose(csv);
 }
 
@@ -524,10 +1139,36 @@ int select_shortest_job(Process p[], bool finished[], int total_procs)
     return temp;
 }
 
+int select_shortest_job_of_tenant(Process p[], bool finished[], int total_procs, int tenant)
+{
+    double min_burst = 1e18;
+    int temp = -1;
+    for (int i = 0; i < total_procs; i++)
+    {
+        if (!finished[i] && p[i].tenant == tenant && p[i].est_burst < min_burst)
+        {
+            min_burst = p[i].est_burst;
+            temp = i;
+        }
+    }
+    return temp;
+}
+
 void ShortestJobFirst(int k)
 {
     uint64_t scheduler_start = get_time_ms();
     FILE *csv = fopen("result_online_SJF_output.csv", "w");
+    trace_begin("online SJF");
+    tenant_reset();
+    limits_begin();
+    prefetch_begin();
+    atomic_store(&submit_slots_left, MAX_PROCS);
+    // Attach first: the intake thread takes job ids from the shared counter.
+    shared_begin();
+    if (submit_socket_path != NULL)
+    {
+        submit_start(submit_socket_path);
+    }
     signal(SIGINT, handle_sigint);
     fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
 
@@ -535,6 +1176,11 @@ void ShortestJobFirst(int k)
     bool finished[MAX_PROCS] = {0};
     pid_t pids[MAX_PROCS] = {0};
     uint64_t cpu_time_used_ms[MAX_PROCS] = {0};
+    PerfCounters perf[MAX_PROCS] = {0};
+    JobLimit limit;
+    ExecProbe probe;
+    CaptureState capture;
+    bool hinted[MAX_PROCS] = {0};
     int total_procs = 0;
 
     bool interactive = isatty(STDIN_FILENO);
@@ -549,33 +1195,39 @@ void ShortestJobFirst(int k)
 
     while (!terminate_flag)
     {
-        if (interactive)
+        total_procs = poll_arrivals(procs, total_procs, finished, interactive, scheduler_start);
+        for (int i = 0; i < total_procs; i++)
         {
-            total_procs = read_new_arrivals(procs, total_procs, scheduler_start);
+            int idx = add_cmd_history(procs[i].command);
+            procs[i].est_burst = idx >= 0 ? estimate_burst(idx, k) : burst_model_predict(&procs[i].features);
         }
-        for (int i = 0; i < total_procs; i++)
+        int idx;
+        if (tenant_fair_share && tenant_next() != -1)
         {
-            int idx = find_cmd_index(procs[i].command);
-            if (idx == -1 && total_cmds < MAX_CMDS)
-            {
-                cmd_history[total_cmds] = strdup(procs[i].command);
-                idx = total_cmds;
-                total_cmds++;
-            }
-
-            procs[i].est_burst = estimate_burst(idx, k);
+            idx = select_shortest_job_of_tenant(procs, finished, total_procs, tenant_next());
+        }
+        else
+        {
+            idx = select_shortest_job(procs, finished, total_procs);
         }
-        int idx = select_shortest_job(procs, finished, total_procs);
 
         if (idx == -1)
         {
             continue;
         }
 
+        if (prefetch_enabled)
+        {
+            prefetch_upcoming_sjf(procs, finished, total_procs, idx, hinted);
+        }
+
         uint64_t start = get_time_ms() - scheduler_start;
         procs[idx].start_time = start;
         procs[idx].started = true;
 
+        int probe_fds[2];
+        capture_prepare(&capture, procs[idx].job_id);
+        exec_probe_pipe(probe_fds, procs[idx].command);
         pid_t pid = fork();
         if (pid == 0)
         {
@@ -584,21 +1236,47 @@ void ShortestJobFirst(int k)
             strncpy(cmd_copy, procs[idx].command, sizeof(cmd_copy) - 1);
             cmd_copy[sizeof(cmd_copy) - 1] = '\0';
             char **argv = parse_command(cmd_copy);
+            capture_child(&capture);
+            precision_child();
+            gang_exec_pipeline(procs[idx].command);
             execvp(argv[0], argv);
             perror("execvp failed");
+            exec_probe_failed(probe_fds);
             _exit(EXIT_FAILURE);
         }
         else if (pid > 0)
         {
+            gang_parent(pid, procs[idx].command);
+            exec_probe_parent(&probe, probe_fds, hinted[idx]);
+            capture_parent(&capture, true);
             pids[idx] = pid;
+            shm_job_started(procs[idx].shm_slot, pid);
+            if (perf_enabled)
+            {
+                job_signal(pid, SIGSTOP);
+                perf_open_job(&perf[idx], pid);
+                job_signal(pid, SIGCONT);
+            }
+            limit_job_start(&limit, pid, procs[idx].cpu_limit_ms, procs[idx].wall_limit_ms);
+            limit_job_resumed(&limit);
+            while (probe.fd >= 0)
+            {
+                exec_probe_wait(&probe, 1);
+                limits_poll();
+                capture_drain_all();
+            }
             int status;
-            waitpid(pid, &status, 0);
+            capture_waitpid(pid, &status);
+            limit_job_exited(&limit);
+            capture_job_exited(&capture);
+            perf_read_job(&perf[idx]);
 
             uint64_t end = get_time_ms() - scheduler_start;
             procs[idx].completion_time = end;
             procs[idx].finished = WIFEXITED(status);
             procs[idx].error = !procs[idx].finished || WEXITSTATUS(status) != 0;
             finished[idx] = true;
+            shm_release(procs[idx].shm_slot, true);
 
             uint64_t burst_time = procs[idx].completion_time - procs[idx].start_time;
             procs[idx].turnaround_time = procs[idx].completion_time - procs[idx].arrival_time;
@@ -614,34 +1292,74 @@ void ShortestJobFirst(int k)
             }
 
             cpu_time_used_ms[idx] = burst_time;
+            tenant_charge(procs[idx].tenant, burst_time);
+            tenant_record(procs[idx].tenant, procs[idx].turnaround_time, procs[idx].response_time);
+            tenant_job_done(procs[idx].tenant);
 
             printf("%s, %llu, %llu\n",
                    procs[idx].command,
                    (unsigned long long)procs[idx].start_time,
                    (unsigned long long)procs[idx].completion_time);
+            trace_slice(procs[idx].command, -1, procs[idx].start_time, procs[idx].completion_time);
 
-            fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu\n",
+            fprintf(csv, "%s,%s,%s,%llu,%llu,%llu,%llu",
                     procs[idx].command,
                     procs[idx].finished ? "Yes" : "No",
-                    procs[idx].error ? "Yes" : "No",
+                    limit_error_field(&limit, procs[idx].error),
                     (unsigned long long)procs[idx].completion_time,
                     (unsigned long long)procs[idx].turnaround_time,
                     (unsigned long long)procs[idx].waiting_time,
                     (unsigned long long)procs[idx].response_time);
+            if (tenant_fair_share)
+            {
+                fprintf(csv, ",%s", tenants[procs[idx].tenant].name);
+            }
+            perf_csv_columns(csv, &perf[idx]);
+            fprintf(csv, "\n");
             fflush(csv);
 
             int cmd_idx = find_cmd_index(procs[idx].command);
+            double burst = (double)burst_time;
+            double cpu_ms = perf_task_clock_ms(&perf[idx]);
+            if (cpu_ms >= 0.0)
+            {
+                burst = cpu_ms;
+            }
             if (cmd_idx != -1)
             {
-                register_burst_global(cmd_idx, (double)burst_time, procs[idx].error);
+                register_burst_global(cmd_idx, burst, procs[idx].error);
             }
+            else if (!procs[idx].error)
+            {
+                burst_model_observe(&procs[idx].features, burst, false);
+            }
+            perf_close_job(&perf[idx]);
         }
         else
         {
             perror("fork failed");
+            exec_probe_abandon(probe_fds);
+            capture_parent(&capture, false);
+            write_fork_failed(csv, &procs[idx], &perf[idx], get_time_ms() - scheduler_start);
+            finished[idx] = true;
+            shm_release(procs[idx].shm_slot, true);
+            tenant_job_done(procs[idx].tenant);
             continue;
         }
     }
+    submit_stop(submit_socket_path);
+    limits_end();
+    capture_end();
+    prefetch_end();
+    prefetch_report();
+    burst_model_report();
+    save_burst_stats();
+    if (tenant_fair_share)
+    {
+        tenant_report("result_online_SJF_tenants.csv");
+    }
+    shared_end(procs, total_procs, pids, finished);
+    trace_end();
     fclose(csv);
     printf("\nScheduler terminated by Ctrl+C.\n");
 }
@@ -0,0 +1,134 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "mono_clock.h"
+
+// ------------------ CONSTANTS ------------------
+#define ADMIT_RECHECK_MS 100
+
+// Admission limits for jobs that have been forked but not finished. A value
+// of 0 disables that limit. PSI limits are compared against "some avg10".
+int admit_max_in_flight = 0;
+uint64_t admit_max_rss_kb = 0;
+double admit_max_psi_cpu = 0.0;
+double admit_max_psi_memory = 0.0;
+double admit_max_psi_io = 0.0;
+
+bool admit_last_decision = true;
+uint64_t admit_last_check_ms = 0;
+int admit_deferrals = 0;
+
+uint64_t read_rss_kb(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    unsigned long size = 0, resident = 0;
+    if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(fp);
+    return (uint64_t)resident * (uint64_t)(sysconf(_SC_PAGESIZE) / 1024);
+}
+
+double read_psi_avg10(const char *resource)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/pressure/%s", resource);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return 0.0;
+    }
+    double avg10 = 0.0;
+    if (fscanf(fp, "some avg10=%lf", &avg10) != 1)
+    {
+        avg10 = 0.0;
+    }
+    fclose(fp);
+    return avg10;
+}
+
+bool admission_pressure_ok(const pid_t pids[], const bool finished[], int n)
+{
+    if (admit_max_rss_kb > 0)
+    {
+        uint64_t rss = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (pids[i] > 0 && !finished[i])
+            {
+                rss += read_rss_kb(pids[i]);
+            }
+        }
+        if (rss > admit_max_rss_kb)
+        {
+            return false;
+        }
+    }
+    if (admit_max_psi_cpu > 0.0 && read_psi_avg10("cpu") > admit_max_psi_cpu)
+    {
+        return false;
+    }
+    if (admit_max_psi_memory > 0.0 && read_psi_avg10("memory") > admit_max_psi_memory)
+    {
+        return false;
+    }
+    if (admit_max_psi_io > 0.0 && read_psi_avg10("io") > admit_max_psi_io)
+    {
+        return false;
+    }
+    return true;
+}
+
+// Decides whether one more job may be forked. With nothing in flight a job
+// is always admitted so that outside pressure can never stall the scheduler.
+// The /proc reads are rate limited to one pass per ADMIT_RECHECK_MS.
+bool admission_open(const pid_t pids[], const bool finished[], int n)
+{
+    int in_flight = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (pids[i] > 0 && !finished[i])
+        {
+            in_flight++;
+        }
+    }
+    if (in_flight == 0)
+    {
+        return true;
+    }
+    if (admit_max_in_flight > 0 && in_flight >= admit_max_in_flight)
+    {
+        admit_deferrals++;
+        return false;
+    }
+    if (admit_max_rss_kb == 0 && admit_max_psi_cpu <= 0.0 &&
+        admit_max_psi_memory <= 0.0 && admit_max_psi_io <= 0.0)
+    {
+        return true;
+    }
+
+    uint64_t now = mono_time_ms();
+    if (admit_last_check_ms == 0 || now - admit_last_check_ms >= ADMIT_RECHECK_MS)
+    {
+        admit_last_decision = admission_pressure_ok(pids, finished, n);
+        admit_last_check_ms = now;
+    }
+    if (!admit_last_decision)
+    {
+        admit_deferrals++;
+    }
+    return admit_last_decision;
+}
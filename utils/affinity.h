@@ -0,0 +1,155 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <sched.h>
+#include <sys/types.h>
+
+#include "mono_clock.h"
+#include "precision.h"
+
+// When enabled, a stopped job is pinned back to the CPU it last ran on as
+// long as it is still cache-hot. A job is taken as hot while it has been
+// stopped for less than migration_cost_ms plus affinity_hot_slices times its
+// last slice: with one job running at a time, a CPU is only reused by the
+// jobs dispatched in between, so the window grows with the quantum. Colder
+// jobs are released to every allowed CPU.
+bool affinity_enabled = false;
+int migration_cost_ms = 5;
+int affinity_hot_slices = 4;
+
+int affinity_pinned = 0;
+int affinity_released = 0;
+int affinity_migrations = 0;
+
+typedef struct
+{
+    bool seen;
+    int last_cpu;
+    uint64_t resumed_at_ms;
+    uint64_t stopped_at_ms;
+    uint64_t hot_ms;
+} AffinityState;
+
+int read_last_cpu(pid_t pid)
+{
+    char path[64];
+    char buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+
+    // "processor" is field 39; the scan starts at field 3 (state).
+    char *p = strrchr(buf, ')');
+    if (p == NULL)
+    {
+        return -1;
+    }
+    p += 2;
+    for (int field = 3; field < 39 && p != NULL; field++)
+    {
+        p = strchr(p, ' ');
+        if (p != NULL)
+        {
+            p++;
+        }
+    }
+    return p != NULL ? atoi(p) : -1;
+}
+
+// Applies the mask to every thread of the job, not only its main thread.
+void set_job_affinity(pid_t pid, const cpu_set_t *mask)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", (int)pid);
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+    {
+        sched_setaffinity(pid, sizeof(cpu_set_t), mask);
+        return;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        if (ent->d_name[0] != '.')
+        {
+            sched_setaffinity((pid_t)atoi(ent->d_name), sizeof(cpu_set_t), mask);
+        }
+    }
+    closedir(dir);
+}
+
+void affinity_job_stopped(AffinityState *a, pid_t pid)
+{
+    if (!affinity_enabled)
+    {
+        return;
+    }
+    int cpu = read_last_cpu(pid);
+    if (cpu < 0)
+    {
+        return;
+    }
+    if (a->seen && cpu != a->last_cpu)
+    {
+        affinity_migrations++;
+    }
+    a->seen = true;
+    a->last_cpu = cpu;
+    a->stopped_at_ms = mono_time_ms();
+    a->hot_ms = (uint64_t)migration_cost_ms + (uint64_t)affinity_hot_slices * (a->stopped_at_ms - a->resumed_at_ms);
+}
+
+void affinity_job_resuming(AffinityState *a, pid_t pid)
+{
+    if (!affinity_enabled)
+    {
+        return;
+    }
+    uint64_t now = mono_time_ms();
+    a->resumed_at_ms = now;
+    if (!a->seen)
+    {
+        return;
+    }
+
+    cpu_set_t mask;
+    if (now - a->stopped_at_ms < a->hot_ms)
+    {
+        CPU_ZERO(&mask);
+        CPU_SET(a->last_cpu, &mask);
+        affinity_pinned++;
+    }
+    else
+    {
+        if (precision_job_affinity(&mask) < 0)
+        {
+            return;
+        }
+        affinity_released++;
+    }
+    set_job_affinity(pid, &mask);
+}
+
+void affinity_report()
+{
+    if (!affinity_enabled)
+    {
+        return;
+    }
+    printf("Affinity: %d resumes pinned, %d released, %d CPU migrations\n",
+           affinity_pinned, affinity_released, affinity_migrations);
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+// ------------------ CONSTANTS ------------------
+#define BURST_MODEL_SLOTS 1024
+#define BURST_MODEL_DECAY 0.9
+#define BURST_MODEL_DEFAULT_MS 1000.0
+
+// With burst_model_enabled, a command without history of its own is
+// predicted from similar commands: first those with the same executable and
+// first argument, then those with the same executable. Each group keeps a
+// decayed least-squares fit of log(burst) against log(size of the command's
+// file arguments), so "sort big.txt" predicts longer than "sort small.txt".
+bool burst_model_enabled = false;
+
+typedef struct
+{
+    uint64_t exe_key;
+    uint64_t prefix_key;
+    double size_x;
+} BurstFeatures;
+
+typedef struct
+{
+    uint64_t key;
+    double n;
+    double sx;
+    double sy;
+    double sxx;
+    double sxy;
+} BurstBucket;
+
+enum
+{
+    BURST_FROM_PREFIX,
+    BURST_FROM_EXE,
+    BURST_FROM_DEFAULT
+};
+
+BurstBucket burst_buckets[BURST_MODEL_SLOTS];
+int burst_model_used[3] = {0};
+int burst_model_samples = 0;
+double burst_model_err[2] = {0.0};
+int burst_model_within_2x[2] = {0};
+
+uint64_t burst_key(const char *s, size_t len, uint64_t h)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+    }
+    return h ? h : 1;
+}
+
+// Tokenizes a copy of cmd once; the features are cached per command.
+void burst_features(const char *cmd, BurstFeatures *f)
+{
+    memset(f, 0, sizeof(*f));
+    char *copy = strdup(cmd);
+    char *save = NULL;
+    char *exe = strtok_r(copy, " \t\n", &save);
+    if (exe == NULL)
+    {
+        free(copy);
+        return;
+    }
+    const char *base = strrchr(exe, '/');
+    base = base ? base + 1 : exe;
+    f->exe_key = burst_key(base, strlen(base), 1469598103934665603ULL);
+
+    uint64_t bytes = 0;
+    char *arg;
+    bool first = true;
+    while ((arg = strtok_r(NULL, " \t\n", &save)) != NULL)
+    {
+        if (first)
+        {
+            f->prefix_key = burst_key(arg, strlen(arg), f->exe_key);
+            first = false;
+        }
+        struct stat st;
+        if (arg[0] != '-' && stat(arg, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            bytes += (uint64_t)st.st_size;
+        }
+    }
+    f->size_x = log2(1.0 + bytes / 1024.0);
+    free(copy);
+}
+
+BurstBucket *burst_bucket(uint64_t key, bool create)
+{
+    if (key == 0)
+    {
+        return NULL;
+    }
+    for (int probe = 0; probe < BURST_MODEL_SLOTS; probe++)
+    {
+        BurstBucket *b = &burst_buckets[(key + probe) & (BURST_MODEL_SLOTS - 1)];
+        if (b->key == key)
+        {
+            return b;
+        }
+        if (b->key == 0)
+        {
+            if (!create)
+            {
+                return NULL;
+            }
+            b->key = key;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+void burst_bucket_add(BurstBucket *b, double x, double y)
+{
+    if (b == NULL)
+    {
+        return;
+    }
+    b->n = b->n * BURST_MODEL_DECAY + 1.0;
+    b->sx = b->sx * BURST_MODEL_DECAY + x;
+    b->sy = b->sy * BURST_MODEL_DECAY + y;
+    b->sxx = b->sxx * BURST_MODEL_DECAY + x * x;
+    b->sxy = b->sxy * BURST_MODEL_DECAY + x * y;
+}
+
+bool burst_bucket_predict(const BurstBucket *b, double x, double *ms)
+{
+    if (b == NULL || b->n < 0.5)
+    {
+        return false;
+    }
+    double mx = b->sx / b->n;
+    double my = b->sy / b->n;
+    double var = b->sxx / b->n - mx * mx;
+    double y = my;
+    if (b->n > 1.5 && var > 0.01)
+    {
+        double slope = (b->sxy / b->n - mx * my) / var;
+        slope = slope < 0.0 ? 0.0 : (slope > 2.0 ? 2.0 : slope);
+        y += slope * (x - mx);
+    }
+    *ms = exp(y) - 1.0;
+    return true;
+}
+
+double burst_model_predict_from(const BurstFeatures *f, int *source)
+{
+    double ms;
+    *source = BURST_FROM_DEFAULT;
+    if (burst_bucket_predict(burst_bucket(f->prefix_key, false), f->size_x, &ms))
+    {
+        *source = BURST_FROM_PREFIX;
+        return ms;
+    }
+    if (burst_bucket_predict(burst_bucket(f->exe_key, false), f->size_x, &ms))
+    {
+        *source = BURST_FROM_EXE;
+        return ms;
+    }
+    return BURST_MODEL_DEFAULT_MS;
+}
+
+// Estimate for a command with no history of its own.
+double burst_model_predict(const BurstFeatures *f)
+{
+    int source;
+    if (!burst_model_enabled)
+    {
+        return BURST_MODEL_DEFAULT_MS;
+    }
+    return burst_model_predict_from(f, &source);
+}
+
+// Called with each finished job's burst. seen says whether the command had
+// history of its own, in which case the model was not needed for it.
+void burst_model_observe(const BurstFeatures *f, double burst, bool seen)
+{
+    if (!burst_model_enabled)
+    {
+        return;
+    }
+    if (!seen)
+    {
+        int source;
+        double predicted[2] = {BURST_MODEL_DEFAULT_MS, burst_model_predict_from(f, &source)};
+        burst_model_used[source]++;
+        burst_model_samples++;
+        for (int i = 0; i < 2; i++)
+        {
+            burst_model_err[i] += fabs(predicted[i] - burst);
+            if (predicted[i] <= 2.0 * burst && burst <= 2.0 * predicted[i])
+            {
+                burst_model_within_2x[i]++;
+            }
+        }
+    }
+    double y = log(1.0 + burst);
+    burst_bucket_add(burst_bucket(f->prefix_key, true), f->size_x, y);
+    burst_bucket_add(burst_bucket(f->exe_key, true), f->size_x, y);
+}
+
+void burst_model_report()
+{
+    if (!burst_model_enabled || burst_model_samples == 0)
+    {
+        return;
+    }
+    printf("\nBurst prediction for %d jobs without history (%d by prefix, %d by executable, %d default):\n",
+           burst_model_samples, burst_model_used[BURST_FROM_PREFIX],
+           burst_model_used[BURST_FROM_EXE], burst_model_used[BURST_FROM_DEFAULT]);
+    const char *label[2] = {"default", "model"};
+    for (int i = 0; i < 2; i++)
+    {
+        printf("  %-8s mean abs error %.1f ms, within 2x %.1f%%\n", label[i],
+               burst_model_err[i] / burst_model_samples,
+               100.0 * burst_model_within_2x[i] / burst_model_samples);
+    }
+}
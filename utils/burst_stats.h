@@ -0,0 +1,128 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+
+// ------------------ CONSTANTS ------------------
+#define MAX_BURST_STATS 1024
+#define BURST_STATS_LINE 4096
+
+// Per-command burst statistics shared between runs: the online schedulers
+// merge what they measured into burst_stats_path on exit, and the offline
+// planner reads it to order a batch. One "mean_ms<TAB>count<TAB>command"
+// line per command.
+const char *burst_stats_path = NULL;
+
+typedef struct
+{
+    char *command;
+    double mean_ms;
+    int count;
+} BurstStat;
+
+BurstStat burst_stats[MAX_BURST_STATS];
+int burst_stats_count = 0;
+
+BurstStat *burst_stats_find(const char *command)
+{
+    for (int i = 0; i < burst_stats_count; i++)
+    {
+        if (strcmp(burst_stats[i].command, command) == 0)
+        {
+            return &burst_stats[i];
+        }
+    }
+    return NULL;
+}
+
+double burst_stats_lookup(const char *command)
+{
+    BurstStat *st = burst_stats_find(command);
+    return st != NULL ? st->mean_ms : -1.0;
+}
+
+// Folds count new samples with the given mean into the command's entry.
+void burst_stats_merge(const char *command, double mean_ms, int count)
+{
+    if (count < 1)
+    {
+        count = 1;
+    }
+    BurstStat *st = burst_stats_find(command);
+    if (st == NULL)
+    {
+        if (burst_stats_count == MAX_BURST_STATS)
+        {
+            return;
+        }
+        st = &burst_stats[burst_stats_count++];
+        st->command = strdup(command);
+        st->mean_ms = 0.0;
+        st->count = 0;
+    }
+    st->mean_ms = (st->mean_ms * st->count + mean_ms * count) / (st->count + count);
+    st->count += count;
+}
+
+void burst_stats_clear()
+{
+    for (int i = 0; i < burst_stats_count; i++)
+    {
+        free(burst_stats[i].command);
+    }
+    burst_stats_count = 0;
+}
+
+// Returns the number of entries read, or -1 if the file cannot be opened.
+int burst_stats_load(const char *path)
+{
+    burst_stats_clear();
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    char line[BURST_STATS_LINE];
+    while (fgets(line, sizeof(line), fp))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *end;
+        double mean_ms = strtod(line, &end);
+        if (end == line || *end != '\t')
+        {
+            continue;
+        }
+        int count = (int)strtol(end + 1, &end, 10);
+        if (*end != '\t' || end[1] == '\0')
+        {
+            continue;
+        }
+        burst_stats_merge(end + 1, mean_ms, count);
+    }
+    fclose(fp);
+    return burst_stats_count;
+}
+
+bool burst_stats_save(const char *path)
+{
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "w");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    for (int i = 0; i < burst_stats_count; i++)
+    {
+        fprintf(fp, "%.3f\t%d\t%s\n", burst_stats[i].mean_ms, burst_stats[i].count, burst_stats[i].command);
+    }
+    if (fclose(fp) != 0 || rename(tmp, path) != 0)
+    {
+        unlink(tmp);
+        return false;
+    }
+    return true;
+}
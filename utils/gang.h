@@ -0,0 +1,190 @@
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+// ------------------ CONSTANTS ------------------
+#define GANG_MAX_STAGES 16
+#define GANG_MAX_ARGS 100
+
+// A command containing '|' runs as a pipeline gang. The forked job process
+// becomes a process-group leader, starts every stage inside its group with
+// pipes between them and waits for them all. The scheduler signals the whole
+// group, so every stage stops and resumes together. The gang exits with the
+// last stage's status, the way a shell pipeline does.
+
+bool gang_is_pipeline(const char *command)
+{
+    return strchr(command, '|') != NULL;
+}
+
+// Sends sig to the job's whole group when it leads one, otherwise to the job.
+int job_signal(pid_t pid, int sig)
+{
+    if (getpgid(pid) == pid)
+    {
+        return kill(-pid, sig);
+    }
+    return kill(pid, sig);
+}
+
+// In the parent right after fork(), so the group exists before any signal.
+void gang_parent(pid_t pid, const char *command)
+{
+    if (gang_is_pipeline(command))
+    {
+        setpgid(pid, pid);
+    }
+}
+
+// The gang leader never calls exec, so it drops what exec would have closed.
+void gang_close_cloexec()
+{
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL)
+    {
+        return;
+    }
+    int self = dirfd(dir);
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL)
+    {
+        int fd = atoi(de->d_name);
+        if (de->d_name[0] == '.' || fd == self)
+        {
+            continue;
+        }
+        int flags = fcntl(fd, F_GETFD);
+        if (flags >= 0 && (flags & FD_CLOEXEC))
+        {
+            close(fd);
+        }
+    }
+    closedir(dir);
+}
+
+int gang_split_args(char *stage, char *argv[])
+{
+    int argc = 0;
+    char *save = NULL;
+    char *token = strtok_r(stage, " \t\n", &save);
+    while (token != NULL && argc < GANG_MAX_ARGS - 1)
+    {
+        argv[argc++] = token;
+        token = strtok_r(NULL, " \t\n", &save);
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// In the child in place of execvp(). Returns only if command is not a pipeline.
+void gang_exec_pipeline(const char *command)
+{
+    if (!gang_is_pipeline(command))
+    {
+        return;
+    }
+    setpgid(0, 0);
+
+    // Split by hand: strtok would fold "a || b" into "a | b".
+    char *copy = strdup(command);
+    char *stages[GANG_MAX_STAGES];
+    int n = 0;
+    for (char *stage = copy; stage != NULL; n++)
+    {
+        char *bar = strchr(stage, '|');
+        if (bar != NULL)
+        {
+            *bar = '\0';
+        }
+        if (n == GANG_MAX_STAGES)
+        {
+            fprintf(stderr, "pipeline has more than %d stages\n", GANG_MAX_STAGES);
+            _exit(EXIT_FAILURE);
+        }
+        if (stage[strspn(stage, " \t\n")] == '\0')
+        {
+            fprintf(stderr, "empty pipeline stage\n");
+            _exit(EXIT_FAILURE);
+        }
+        stages[n] = stage;
+        stage = bar != NULL ? bar + 1 : NULL;
+    }
+
+    pid_t pids[GANG_MAX_STAGES];
+    int in_fd = -1;
+    for (int i = 0; i < n; i++)
+    {
+        int fds[2] = {-1, -1};
+        if (i < n - 1 && pipe(fds) < 0)
+        {
+            perror("pipe failed");
+            _exit(EXIT_FAILURE);
+        }
+
+        pids[i] = fork();
+        if (pids[i] == 0)
+        {
+            if (in_fd >= 0)
+            {
+                dup2(in_fd, STDIN_FILENO);
+                close(in_fd);
+            }
+            if (fds[1] >= 0)
+            {
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[0]);
+                close(fds[1]);
+            }
+            char *argv[GANG_MAX_ARGS];
+            gang_split_args(stages[i], argv);
+            execvp(argv[0], argv);
+            perror("execvp failed");
+            _exit(127);
+        }
+        if (pids[i] < 0)
+        {
+            perror("fork failed");
+            kill(0, SIGKILL);
+        }
+
+        if (in_fd >= 0)
+        {
+            close(in_fd);
+        }
+        if (fds[1] >= 0)
+        {
+            close(fds[1]);
+        }
+        in_fd = fds[0];
+    }
+    gang_close_cloexec();
+
+    int last_status = 0;
+    int remaining = n;
+    while (remaining > 0)
+    {
+        int status;
+        pid_t done = wait(&status);
+        if (done < 0)
+        {
+            break;
+        }
+        if (done == pids[n - 1])
+        {
+            last_status = status;
+        }
+        remaining--;
+    }
+    if (WIFSIGNALED(last_status))
+    {
+        _exit(128 + WTERMSIG(last_status));
+    }
+    _exit(WEXITSTATUS(last_status));
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "gang.h"
+#include "mono_clock.h"
+#include "timer_wheel.h"
+
+// Per-job CPU and wall-clock limits in ms; 0 means unlimited. A job's own
+// "@cpu=" / "@wall=" metadata overrides the defaults. CPU time is the time
+// the job has spent dispatched. A job over either limit gets SIGTERM, and
+// SIGKILL limit_kill_grace_ms later if it is still around.
+uint64_t default_cpu_limit_ms = 0;
+uint64_t default_wall_limit_ms = 0;
+uint64_t limit_kill_grace_ms = 1000;
+
+typedef struct
+{
+    TimerNode cpu_timer;
+    TimerNode wall_timer;
+    TimerNode kill_timer;
+    pid_t pid;
+    uint64_t cpu_limit_ms;
+    uint64_t cpu_used_ms;
+    uint64_t run_start_ms;
+    bool running;
+    bool timed_out;
+} JobLimit;
+
+TimerWheel limit_wheel;
+int limit_timeouts = 0;
+
+void limits_begin()
+{
+    tw_init(&limit_wheel, mono_time_ms());
+    limit_timeouts = 0;
+}
+
+// Drops every armed timer; the JobLimit arrays they point into are going away.
+void limits_end()
+{
+    tw_init(&limit_wheel, mono_time_ms());
+    if (limit_timeouts > 0)
+    {
+        printf("\nTime limits: %d jobs terminated\n", limit_timeouts);
+    }
+}
+
+void limit_fire(TimerNode *node)
+{
+    JobLimit *jl = node->data;
+    if (node == &jl->kill_timer)
+    {
+        job_signal(jl->pid, SIGKILL);
+        return;
+    }
+
+    jl->timed_out = true;
+    limit_timeouts++;
+    tw_del(&limit_wheel, &jl->cpu_timer);
+    tw_del(&limit_wheel, &jl->wall_timer);
+    // A stopped job has to run to act on SIGTERM.
+    job_signal(jl->pid, SIGTERM);
+    job_signal(jl->pid, SIGCONT);
+    tw_add(&limit_wheel, &jl->kill_timer, mono_time_ms() + limit_kill_grace_ms);
+}
+
+void limits_poll()
+{
+    tw_advance(&limit_wheel, mono_time_ms(), limit_fire);
+}
+
+void limit_job_start(JobLimit *jl, pid_t pid, uint64_t cpu_limit_ms, uint64_t wall_limit_ms)
+{
+    memset(jl, 0, sizeof(*jl));
+    jl->pid = pid;
+    jl->cpu_timer.data = jl;
+    jl->wall_timer.data = jl;
+    jl->kill_timer.data = jl;
+    jl->cpu_limit_ms = cpu_limit_ms ? cpu_limit_ms : default_cpu_limit_ms;
+
+    if (wall_limit_ms == 0)
+    {
+        wall_limit_ms = default_wall_limit_ms;
+    }
+    if (wall_limit_ms > 0)
+    {
+        tw_add(&limit_wheel, &jl->wall_timer, mono_time_ms() + wall_limit_ms);
+    }
+}
+
+void limit_job_resumed(JobLimit *jl)
+{
+    jl->run_start_ms = mono_time_ms();
+    jl->running = true;
+    if (jl->cpu_limit_ms > 0 && !jl->timed_out)
+    {
+        uint64_t left = jl->cpu_limit_ms > jl->cpu_used_ms ? jl->cpu_limit_ms - jl->cpu_used_ms : 0;
+        tw_add(&limit_wheel, &jl->cpu_timer, jl->run_start_ms + left);
+    }
+}
+
+void limit_job_stopped(JobLimit *jl)
+{
+    if (jl->running)
+    {
+        jl->cpu_used_ms += mono_time_ms() - jl->run_start_ms;
+        jl->running = false;
+    }
+    tw_del(&limit_wheel, &jl->cpu_timer);
+}
+
+// Must run once the job is reaped so no signal can hit a reused pid.
+void limit_job_exited(JobLimit *jl)
+{
+    limit_job_stopped(jl);
+    tw_del(&limit_wheel, &jl->wall_timer);
+    tw_del(&limit_wheel, &jl->kill_timer);
+}
+
+// waitpid() for a dispatched job that keeps enforcing limits meanwhile.
+pid_t limit_waitpid(pid_t pid, int *status)
+{
+    while (limit_wheel.count > 0)
+    {
+        pid_t res = waitpid(pid, status, WNOHANG);
+        if (res != 0)
+        {
+            return res;
+        }
+        limits_poll();
+        usleep(1000);
+    }
+    return waitpid(pid, status, 0);
+}
+
+const char *limit_error_field(const JobLimit *jl, bool error)
+{
+    if (jl->timed_out)
+    {
+        return "Timeout";
+    }
+    return error ? "Yes" : "No";
+}
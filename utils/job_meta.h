@@ -0,0 +1,92 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Input lines may start with "@key=value" tokens that configure the job
+// rather than form part of the command, e.g. "@nice=5 ./worker --fast".
+typedef struct
+{
+    int nice;
+    char tenant[32];
+    int share;
+    uint64_t cpu_limit_ms;
+    uint64_t wall_limit_ms;
+} JobMeta;
+
+void job_meta_default(JobMeta *meta)
+{
+    memset(meta, 0, sizeof(*meta));
+}
+
+bool job_meta_apply(JobMeta *meta, const char *key, size_t key_len, const char *value)
+{
+    if (key_len == 4 && strncmp(key, "nice", 4) == 0)
+    {
+        int nice = atoi(value);
+        meta->nice = nice < -20 ? -20 : (nice > 19 ? 19 : nice);
+        return true;
+    }
+    if (key_len == 6 && strncmp(key, "tenant", 6) == 0)
+    {
+        strncpy(meta->tenant, value, sizeof(meta->tenant) - 1);
+        meta->tenant[sizeof(meta->tenant) - 1] = '\0';
+        return true;
+    }
+    if (key_len == 5 && strncmp(key, "share", 5) == 0)
+    {
+        meta->share = atoi(value);
+        return true;
+    }
+    if (key_len == 3 && strncmp(key, "cpu", 3) == 0)
+    {
+        meta->cpu_limit_ms = strtoull(value, NULL, 10);
+        return true;
+    }
+    if (key_len == 4 && strncmp(key, "wall", 4) == 0)
+    {
+        meta->wall_limit_ms = strtoull(value, NULL, 10);
+        return true;
+    }
+    return false;
+}
+
+// Parses and removes the leading metadata tokens from line in place, so the
+// remaining string is the command to run. Unknown keys are dropped.
+void strip_job_meta(char *line, JobMeta *meta)
+{
+    job_meta_default(meta);
+
+    char *cur = line;
+    while (*cur == ' ' || *cur == '\t')
+    {
+        cur++;
+    }
+    while (*cur == '@')
+    {
+        char *end = cur + strcspn(cur, " \t");
+        char *eq = memchr(cur, '=', end - cur);
+        if (eq != NULL)
+        {
+            char value[64];
+            size_t vlen = end - eq - 1;
+            if (vlen >= sizeof(value))
+            {
+                vlen = sizeof(value) - 1;
+            }
+            memcpy(value, eq + 1, vlen);
+            value[vlen] = '\0';
+            job_meta_apply(meta, cur + 1, eq - cur - 1, value);
+        }
+        cur = end;
+        while (*cur == ' ' || *cur == '\t')
+        {
+            cur++;
+        }
+    }
+    if (cur != line)
+    {
+        memmove(line, cur, strlen(cur) + 1);
+    }
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// ------------------ CONSTANTS ------------------
+#define LQ_WORD_BITS 64
+#define LQ_MAX_LEVELS (LQ_WORD_BITS * LQ_WORD_BITS)
+
+// One FIFO ring per priority level (0 = highest) plus a two-level bitmap of
+// non-empty levels, so the highest non-empty level is two find-first-set
+// operations regardless of how many levels are configured.
+typedef struct
+{
+    int levels;
+    int capacity;
+    int *slots;
+    int *front;
+    int *count;
+    uint64_t summary;
+    uint64_t words[LQ_WORD_BITS];
+} LevelQueues;
+
+int lq_init(LevelQueues *lq, int levels, int capacity)
+{
+    if (levels < 1 || levels > LQ_MAX_LEVELS || capacity < 1)
+    {
+        return -1;
+    }
+    memset(lq, 0, sizeof(*lq));
+    lq->levels = levels;
+    lq->capacity = capacity;
+    lq->slots = malloc(sizeof(int) * (size_t)levels * (size_t)capacity);
+    lq->front = calloc(levels, sizeof(int));
+    lq->count = calloc(levels, sizeof(int));
+    if (lq->slots == NULL || lq->front == NULL || lq->count == NULL)
+    {
+        free(lq->slots);
+        free(lq->front);
+        free(lq->count);
+        return -1;
+    }
+    return 0;
+}
+
+void lq_free(LevelQueues *lq)
+{
+    free(lq->slots);
+    free(lq->front);
+    free(lq->count);
+    lq->slots = NULL;
+    lq->front = NULL;
+    lq->count = NULL;
+}
+
+void lq_mark(LevelQueues *lq, int level)
+{
+    lq->words[level / LQ_WORD_BITS] |= 1ULL << (level % LQ_WORD_BITS);
+    lq->summary |= 1ULL << (level / LQ_WORD_BITS);
+}
+
+void lq_unmark(LevelQueues *lq, int level)
+{
+    int w = level / LQ_WORD_BITS;
+    lq->words[w] &= ~(1ULL << (level % LQ_WORD_BITS));
+    if (lq->words[w] == 0)
+    {
+        lq->summary &= ~(1ULL << w);
+    }
+}
+
+bool lq_empty(const LevelQueues *lq)
+{
+    return lq->summary == 0;
+}
+
+int lq_size(const LevelQueues *lq, int level)
+{
+    return lq->count[level];
+}
+
+// pos-th entry from the front of level, without removing it, or -1.
+int lq_at(const LevelQueues *lq, int level, int pos)
+{
+    if (pos >= lq->count[level])
+    {
+        return -1;
+    }
+    return lq->slots[(size_t)level * lq->capacity + (lq->front[level] + pos) % lq->capacity];
+}
+
+// Lowest-numbered (highest priority) non-empty level >= from, or -1.
+int lq_next_level(const LevelQueues *lq, int from)
+{
+    if (from >= lq->levels)
+    {
+        return -1;
+    }
+    int w = from / LQ_WORD_BITS;
+    uint64_t bits = lq->words[w] & (~0ULL << (from % LQ_WORD_BITS));
+    if (bits != 0)
+    {
+        return w * LQ_WORD_BITS + __builtin_ctzll(bits);
+    }
+    uint64_t rest = (w + 1 < LQ_WORD_BITS) ? (lq->summary & (~0ULL << (w + 1))) : 0;
+    if (rest == 0)
+    {
+        return -1;
+    }
+    w = __builtin_ctzll(rest);
+    return w * LQ_WORD_BITS + __builtin_ctzll(lq->words[w]);
+}
+
+int lq_highest(const LevelQueues *lq)
+{
+    if (lq->summary == 0)
+    {
+        return -1;
+    }
+    int w = __builtin_ctzll(lq->summary);
+    return w * LQ_WORD_BITS + __builtin_ctzll(lq->words[w]);
+}
+
+bool lq_push(LevelQueues *lq, int level, int val)
+{
+    if (lq->count[level] == lq->capacity)
+    {
+        return false;
+    }
+    int *ring = lq->slots + (size_t)level * lq->capacity;
+    ring[(lq->front[level] + lq->count[level]) % lq->capacity] = val;
+    lq->count[level]++;
+    lq_mark(lq, level);
+    return true;
+}
+
+bool lq_push_front(LevelQueues *lq, int level, int val)
+{
+    if (lq->count[level] == lq->capacity)
+    {
+        return false;
+    }
+    int *ring = lq->slots + (size_t)level * lq->capacity;
+    lq->front[level] = (lq->front[level] + lq->capacity - 1) % lq->capacity;
+    ring[lq->front[level]] = val;
+    lq->count[level]++;
+    lq_mark(lq, level);
+    return true;
+}
+
+int lq_pop(LevelQueues *lq, int level)
+{
+    if (lq->count[level] == 0)
+    {
+        return -1;
+    }
+    int *ring = lq->slots + (size_t)level * lq->capacity;
+    int val = ring[lq->front[level]];
+    lq->front[level] = (lq->front[level] + 1) % lq->capacity;
+    lq->count[level]--;
+    if (lq->count[level] == 0)
+    {
+        lq_unmark(lq, level);
+    }
+    return val;
+}
+
+int lq_pop_highest(LevelQueues *lq, int *level)
+{
+    int l = lq_highest(lq);
+    if (l == -1)
+    {
+        return -1;
+    }
+    if (level != NULL)
+    {
+        *level = l;
+    }
+    return lq_pop(lq, l);
+}
+
+// First level whose quantum covers burst_ms, else the lowest level.
+int lq_level_for_burst(const LevelQueues *lq, const int quanta[], double burst_ms)
+{
+    for (int l = 0; l < lq->levels - 1; l++)
+    {
+        if (burst_ms < (double)quanta[l])
+        {
+            return l;
+        }
+    }
+    return lq->levels - 1;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic clocks for the helpers under utils/. The schedulers themselves
+// keep using get_time_ms() for the values they log.
+
+uint64_t mono_time_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t mono_time_us()
+{
+    return mono_time_ns() / 1000ULL;
+}
+
+uint64_t mono_time_ms()
+{
+    return mono_time_ns() / 1000000ULL;
+}
@@ -0,0 +1,258 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "job_limits.h"
+
+// ------------------ CONSTANTS ------------------
+#define CAPTURE_MAX_LIVE 256
+#define CAPTURE_CHUNK (1 << 16)
+
+// With capture_dir set, every job's stdout and stderr go to pipes instead of
+// the scheduler's terminal. The dispatch loop splices whatever is ready into
+// <capture_dir>/job-<id>.out and .err, so a chatty child never blocks the
+// slice log and the log never interleaves with job output.
+const char *capture_dir = NULL;
+
+typedef struct
+{
+    int pipe_fd[2];
+    int file_fd[2];
+    int write_fd[2];
+    uint64_t bytes[2];
+} CaptureState;
+
+CaptureState *capture_live[CAPTURE_MAX_LIVE];
+int capture_live_count = 0;
+uint64_t capture_total_bytes = 0;
+
+void capture_path(char *buf, size_t len, int job_id, int stream)
+{
+    snprintf(buf, len, "%s/job-%d.%s", capture_dir, job_id, stream == 0 ? "out" : "err");
+}
+
+void capture_close(CaptureState *cs)
+{
+    for (int s = 0; s < 2; s++)
+    {
+        if (cs->pipe_fd[s] >= 0)
+        {
+            close(cs->pipe_fd[s]);
+        }
+        if (cs->write_fd[s] >= 0)
+        {
+            close(cs->write_fd[s]);
+        }
+        if (cs->file_fd[s] >= 0)
+        {
+            close(cs->file_fd[s]);
+        }
+        cs->pipe_fd[s] = cs->write_fd[s] = cs->file_fd[s] = -1;
+    }
+}
+
+// Before fork(). Leaves the job on the inherited stdout/stderr on failure.
+void capture_prepare(CaptureState *cs, int job_id)
+{
+    memset(cs, 0, sizeof(*cs));
+    for (int s = 0; s < 2; s++)
+    {
+        cs->pipe_fd[s] = cs->write_fd[s] = cs->file_fd[s] = -1;
+    }
+    if (capture_dir == NULL || capture_live_count == CAPTURE_MAX_LIVE)
+    {
+        return;
+    }
+
+    for (int s = 0; s < 2; s++)
+    {
+        char path[4096];
+        int fds[2];
+        capture_path(path, sizeof(path), job_id, s);
+        cs->file_fd[s] = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (cs->file_fd[s] < 0 || pipe2(fds, O_CLOEXEC) < 0)
+        {
+            perror("output capture");
+            capture_close(cs);
+            return;
+        }
+        cs->pipe_fd[s] = fds[0];
+        cs->write_fd[s] = fds[1];
+    }
+}
+
+// In the child, before execvp().
+void capture_child(CaptureState *cs)
+{
+    if (cs->write_fd[0] >= 0)
+    {
+        dup2(cs->write_fd[0], STDOUT_FILENO);
+        dup2(cs->write_fd[1], STDERR_FILENO);
+    }
+}
+
+// In the parent after fork(); pass forked = false when fork() failed.
+void capture_parent(CaptureState *cs, bool forked)
+{
+    if (cs->write_fd[0] < 0)
+    {
+        return;
+    }
+    if (!forked)
+    {
+        capture_close(cs);
+        return;
+    }
+    for (int s = 0; s < 2; s++)
+    {
+        close(cs->write_fd[s]);
+        cs->write_fd[s] = -1;
+        fcntl(cs->pipe_fd[s], F_SETFL, O_NONBLOCK);
+    }
+    capture_live[capture_live_count++] = cs;
+}
+
+// Moves what is buffered in one pipe to its file. Returns false at EOF.
+bool capture_drain_stream(CaptureState *cs, int s)
+{
+    while (cs->pipe_fd[s] >= 0)
+    {
+        ssize_t got = splice(cs->pipe_fd[s], NULL, cs->file_fd[s], NULL, CAPTURE_CHUNK,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (got < 0 && errno == EINVAL)
+        {
+            // Target filesystem without splice support.
+            char buf[8192];
+            got = read(cs->pipe_fd[s], buf, sizeof(buf));
+            if (got > 0 && write(cs->file_fd[s], buf, got) != got)
+            {
+                perror("output capture write");
+            }
+        }
+        if (got > 0)
+        {
+            cs->bytes[s] += got;
+            capture_total_bytes += got;
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+// Waits up to timeout_ms for output from any live job and drains it; with
+// nothing captured this is a plain sleep.
+void capture_poll(int timeout_ms)
+{
+    struct pollfd fds[CAPTURE_MAX_LIVE * 2];
+    int n = 0;
+    for (int i = 0; i < capture_live_count; i++)
+    {
+        for (int s = 0; s < 2; s++)
+        {
+            if (capture_live[i]->pipe_fd[s] >= 0)
+            {
+                fds[n].fd = capture_live[i]->pipe_fd[s];
+                fds[n].events = POLLIN;
+                n++;
+            }
+        }
+    }
+    if (poll(fds, n, timeout_ms) <= 0)
+    {
+        return;
+    }
+
+    n = 0;
+    for (int i = 0; i < capture_live_count; i++)
+    {
+        CaptureState *cs = capture_live[i];
+        for (int s = 0; s < 2; s++)
+        {
+            if (cs->pipe_fd[s] < 0)
+            {
+                continue;
+            }
+            if ((fds[n++].revents & (POLLIN | POLLHUP)) && !capture_drain_stream(cs, s))
+            {
+                close(cs->pipe_fd[s]);
+                cs->pipe_fd[s] = -1;
+            }
+        }
+    }
+}
+
+// After the job is reaped: collects its remaining output and closes it.
+void capture_job_exited(CaptureState *cs)
+{
+    for (int i = 0; i < capture_live_count; i++)
+    {
+        if (capture_live[i] == cs)
+        {
+            capture_live[i] = capture_live[--capture_live_count];
+            break;
+        }
+    }
+    for (int s = 0; s < 2; s++)
+    {
+        capture_drain_stream(cs, s);
+    }
+    capture_close(cs);
+}
+
+void capture_end()
+{
+    while (capture_live_count > 0)
+    {
+        capture_job_exited(capture_live[0]);
+    }
+    if (capture_dir != NULL)
+    {
+        printf("\nCaptured %llu bytes of job output in %s\n",
+               (unsigned long long)capture_total_bytes, capture_dir);
+    }
+    capture_total_bytes = 0;
+}
+
+void capture_drain_all()
+{
+    if (capture_live_count > 0)
+    {
+        capture_poll(0);
+    }
+}
+
+// waitpid() for a dispatched job that keeps draining its output and
+// enforcing time limits while it runs.
+pid_t capture_waitpid(pid_t pid, int *status)
+{
+    if (capture_live_count == 0)
+    {
+        return limit_waitpid(pid, status);
+    }
+    while (1)
+    {
+        pid_t res = waitpid(pid, status, WNOHANG);
+        if (res != 0)
+        {
+            return res;
+        }
+        limits_poll();
+        capture_poll(1);
+    }
+}
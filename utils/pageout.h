@@ -0,0 +1,216 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "mono_clock.h"
+#include "admission.h"
+
+// ------------------ CONSTANTS ------------------
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_process_madvise
+#define SYS_process_madvise 440
+#endif
+#define PAGEOUT_IOV_BATCH 512
+
+// Jobs left stopped for pageout_after_ms get their memory advised away with
+// process_madvise(). pageout_advice is MADV_PAGEOUT or MADV_COLD.
+bool pageout_enabled = false;
+int pageout_after_ms = 2000;
+int pageout_advice = MADV_PAGEOUT;
+
+int pageout_count = 0;
+uint64_t pageout_reclaimed_kb = 0;
+uint64_t pageout_refault_pages = 0;
+
+typedef struct
+{
+    uint64_t stopped_since_ms;
+    bool paged_out;
+    uint64_t majflt_at_pageout;
+} PageoutState;
+
+uint64_t read_majflt(pid_t pid)
+{
+    char path[64];
+    char buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+
+    // Fields after the ")" of comm: state ppid pgrp session tty tpgid flags minflt cminflt majflt
+    char *p = strrchr(buf, ')');
+    if (p == NULL)
+    {
+        return 0;
+    }
+    unsigned long long majflt = 0;
+    if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %llu", &majflt) != 1)
+    {
+        return 0;
+    }
+    return majflt;
+}
+
+int pageout_process(pid_t pid)
+{
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0)
+    {
+        return -1;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+    FILE *maps = fopen(path, "r");
+    if (maps == NULL)
+    {
+        close(pidfd);
+        return -1;
+    }
+
+    struct iovec iov[PAGEOUT_IOV_BATCH];
+    int count = 0;
+    int rc = 0;
+    int err = 0;
+    char line[512];
+    while (rc == 0 && fgets(line, sizeof(line), maps))
+    {
+        unsigned long start, end;
+        char perms[5];
+        if (sscanf(line, "%lx-%lx %4s", &start, &end, perms) != 3)
+        {
+            continue;
+        }
+        if (perms[0] != 'r' || strstr(line, "[vvar") || strstr(line, "[vdso]") || strstr(line, "[vsyscall]"))
+        {
+            continue;
+        }
+        iov[count].iov_base = (void *)start;
+        iov[count].iov_len = end - start;
+        count++;
+
+        if (count == PAGEOUT_IOV_BATCH)
+        {
+            if (syscall(SYS_process_madvise, pidfd, iov, count, pageout_advice, 0) < 0)
+            {
+                rc = -1;
+                err = errno;
+            }
+            count = 0;
+        }
+    }
+    if (rc == 0 && count > 0 && syscall(SYS_process_madvise, pidfd, iov, count, pageout_advice, 0) < 0)
+    {
+        rc = -1;
+        err = errno;
+    }
+
+    fclose(maps);
+    close(pidfd);
+    errno = err;
+    return rc;
+}
+
+void pageout_job_stopped(PageoutState *s, pid_t pid)
+{
+    s->stopped_since_ms = mono_time_ms();
+    if (s->paged_out)
+    {
+        uint64_t majflt = read_majflt(pid);
+        if (majflt > s->majflt_at_pageout)
+        {
+            pageout_refault_pages += majflt - s->majflt_at_pageout;
+        }
+        s->paged_out = false;
+    }
+}
+
+void pageout_job_resumed(PageoutState *s)
+{
+    s->stopped_since_ms = 0;
+}
+
+// Called between slices: pages out every job that has been stopped longer
+// than pageout_after_ms and has not been paged out since it last ran.
+void pageout_scan(PageoutState st[], const pid_t pids[], const bool finished[], int n)
+{
+    if (!pageout_enabled)
+    {
+        return;
+    }
+    uint64_t now = mono_time_ms();
+    for (int i = 0; i < n; i++)
+    {
+        if (pids[i] <= 0 || finished[i] || st[i].stopped_since_ms == 0 || st[i].paged_out)
+        {
+            continue;
+        }
+        if (now - st[i].stopped_since_ms < (uint64_t)pageout_after_ms)
+        {
+            continue;
+        }
+
+        uint64_t rss_before = read_rss_kb(pids[i]);
+        if (pageout_process(pids[i]) < 0)
+        {
+            // Only a missing syscall or missing permission holds for every
+            // job; anything else (EINVAL on one mapping, a job that just
+            // exited) is retried for that job after another wait.
+            if (errno == EPERM || errno == ENOSYS)
+            {
+                perror("process_madvise failed, disabling pageout");
+                pageout_enabled = false;
+                return;
+            }
+            st[i].stopped_since_ms = now;
+            continue;
+        }
+        uint64_t rss_after = read_rss_kb(pids[i]);
+
+        st[i].paged_out = true;
+        st[i].majflt_at_pageout = read_majflt(pids[i]);
+        pageout_count++;
+        if (rss_before > rss_after)
+        {
+            pageout_reclaimed_kb += rss_before - rss_after;
+        }
+    }
+}
+
+void pageout_report()
+{
+    if (pageout_count == 0)
+    {
+        return;
+    }
+    printf("Pageout: %d stopped jobs paged out, %llu kB reclaimed, %llu pages faulted back\n",
+           pageout_count,
+           (unsigned long long)pageout_reclaimed_kb,
+           (unsigned long long)pageout_refault_pages);
+}
@@ -0,0 +1,225 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+// ------------------ CONSTANTS ------------------
+#define PERF_MAX_JOBS 64
+
+// Optional per-job perf_event_open counters. Software counters work
+// everywhere; hardware ones are simply left out when no PMU is exposed.
+// Counters stay open while a job is stopped, so at most PERF_MAX_JOBS jobs
+// hold them at once; later jobs run without and get empty columns.
+bool perf_enabled = false;
+int perf_jobs_open = 0;
+int perf_jobs_skipped = 0;
+FILE *perf_slice_csv = NULL;
+
+enum
+{
+    PERF_TASK_CLOCK,
+    PERF_CTX_SWITCHES,
+    PERF_PAGE_FAULTS,
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_CACHE_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+const char *perf_counter_names[PERF_NUM_COUNTERS] = {
+    "task_clock_ms", "context_switches", "page_faults",
+    "instructions", "cycles", "cache_misses",
+};
+
+typedef struct
+{
+    int fd[PERF_NUM_COUNTERS];
+    uint64_t total[PERF_NUM_COUNTERS];
+    uint64_t slice[PERF_NUM_COUNTERS];
+    bool available[PERF_NUM_COUNTERS];
+    bool opened;
+} PerfCounters;
+
+int perf_open_counter(pid_t pid, uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.inherit = 1;
+    // Kernel-side exclusion keeps hardware counters usable at
+    // perf_event_paranoid=2; software events are kernel-side by nature.
+    attr.exclude_kernel = type == PERF_TYPE_HARDWARE;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+void perf_open_job(PerfCounters *pc, pid_t pid)
+{
+    memset(pc, 0, sizeof(*pc));
+    if (!perf_enabled || perf_jobs_open == PERF_MAX_JOBS)
+    {
+        for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        {
+            pc->fd[c] = -1;
+        }
+        perf_jobs_skipped += perf_enabled;
+        return;
+    }
+    pc->fd[PERF_TASK_CLOCK] = perf_open_counter(pid, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    pc->fd[PERF_CTX_SWITCHES] = perf_open_counter(pid, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+    pc->fd[PERF_PAGE_FAULTS] = perf_open_counter(pid, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    pc->fd[PERF_INSTRUCTIONS] = perf_open_counter(pid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    pc->fd[PERF_CYCLES] = perf_open_counter(pid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    pc->fd[PERF_CACHE_MISSES] = perf_open_counter(pid, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        pc->available[c] = pc->fd[c] >= 0;
+    }
+    pc->opened = true;
+    perf_jobs_open++;
+}
+
+// Reads the running totals and keeps what accrued since the last read in
+// slice[]. Called at every SIGSTOP and once more after the job exits.
+void perf_read_job(PerfCounters *pc)
+{
+    if (!pc->opened)
+    {
+        return;
+    }
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        uint64_t value;
+        pc->slice[c] = 0;
+        if (pc->fd[c] >= 0 && read(pc->fd[c], &value, sizeof(value)) == sizeof(value))
+        {
+            pc->slice[c] = value - pc->total[c];
+            pc->total[c] = value;
+        }
+    }
+}
+
+void perf_close_job(PerfCounters *pc)
+{
+    if (!pc->opened)
+    {
+        return;
+    }
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        if (pc->fd[c] >= 0)
+        {
+            close(pc->fd[c]);
+            pc->fd[c] = -1;
+        }
+    }
+    pc->opened = false;
+    perf_jobs_open--;
+}
+
+// CPU time actually consumed by the job, or -1 without a task-clock counter.
+double perf_task_clock_ms(const PerfCounters *pc)
+{
+    if (!pc->available[PERF_TASK_CLOCK])
+    {
+        return -1.0;
+    }
+    return (double)pc->total[PERF_TASK_CLOCK] / 1e6;
+}
+
+void perf_csv_values(FILE *csv, const PerfCounters *pc, const uint64_t values[])
+{
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        if (!pc->available[c])
+        {
+            fprintf(csv, ",");
+        }
+        else if (c == PERF_TASK_CLOCK)
+        {
+            fprintf(csv, ",%.3f", (double)values[c] / 1e6);
+        }
+        else
+        {
+            fprintf(csv, ",%llu", (unsigned long long)values[c]);
+        }
+    }
+}
+
+// Appends the job's totals, in perf_counter_names order, to a CSV row; the
+// caller writes the newline. Counters that could not be opened are left
+// empty.
+void perf_csv_columns(FILE *csv, const PerfCounters *pc)
+{
+    if (!perf_enabled)
+    {
+        return;
+    }
+    perf_csv_values(csv, pc, pc->total);
+}
+
+// Per-slice deltas go to their own CSV, one row per slice of a job that
+// holds counters.
+void perf_slices_begin(const char *path)
+{
+    if (!perf_enabled)
+    {
+        return;
+    }
+    perf_slice_csv = fopen(path, "w");
+    if (perf_slice_csv == NULL)
+    {
+        perror("perf slice csv");
+        return;
+    }
+    fprintf(perf_slice_csv, "command,slice_start_ms,slice_end_ms");
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+    {
+        fprintf(perf_slice_csv, ",%s", perf_counter_names[c]);
+    }
+    fprintf(perf_slice_csv, "\n");
+}
+
+// After perf_read_job() at the end of a slice.
+void perf_slice_row(const char *command, const PerfCounters *pc, uint64_t start_ms, uint64_t end_ms)
+{
+    if (perf_slice_csv == NULL || !pc->opened)
+    {
+        return;
+    }
+    fprintf(perf_slice_csv, "%s,%llu,%llu", command,
+            (unsigned long long)start_ms, (unsigned long long)end_ms);
+    perf_csv_values(perf_slice_csv, pc, pc->slice);
+    fprintf(perf_slice_csv, "\n");
+    fflush(perf_slice_csv);
+}
+
+void perf_slices_end()
+{
+    if (perf_slice_csv != NULL)
+    {
+        fclose(perf_slice_csv);
+        perf_slice_csv = NULL;
+    }
+}
+
+void perf_report()
+{
+    if (perf_jobs_skipped > 0)
+    {
+        printf("Perf counters: %d jobs ran without (more than %d at once)\n", perf_jobs_skipped, PERF_MAX_JOBS);
+    }
+    perf_jobs_skipped = 0;
+}
@@ -0,0 +1,237 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+
+#include "mono_clock.h"
+
+// ------------------ CONSTANTS ------------------
+#define PRECISION_MAX_SAMPLES 65536
+#define PRECISION_POLL_NS 1000000ULL
+#define PRECISION_STACK_PREFAULT (256 * 1024)
+#define PRECISION_BUCKETS 7
+
+// With precision_mode, the dispatch loop runs SCHED_FIFO at
+// precision_rt_priority on a core reserved from its jobs (precision_cpu, or
+// the highest allowed CPU when -1), with its memory locked. Slices end on
+// absolute CLOCK_MONOTONIC deadlines reached with clock_nanosleep.
+// slice_error_report alone records how far slices overshoot without
+// changing how the scheduler runs, as a baseline.
+bool precision_mode = false;
+bool slice_error_report = false;
+int precision_cpu = -1;
+int precision_rt_priority = 50;
+
+typedef struct
+{
+    uint64_t start_ns;
+    uint64_t deadline_ns;
+} SliceTimer;
+
+int precision_reserved_cpu = -1;
+cpu_set_t precision_saved_affinity;
+int precision_saved_policy = -1;
+struct sched_param precision_saved_param;
+int32_t slice_error_us[PRECISION_MAX_SAMPLES];
+int slice_error_count = 0;
+uint64_t slice_error_dropped = 0;
+
+void precision_begin()
+{
+    slice_error_count = 0;
+    slice_error_dropped = 0;
+    precision_reserved_cpu = -1;
+    if (!precision_mode)
+    {
+        return;
+    }
+
+    cpu_set_t *set = &precision_saved_affinity;
+    if (sched_getaffinity(0, sizeof(*set), set) == 0 && CPU_COUNT(set) > 1)
+    {
+        int cpu = precision_cpu;
+        for (int c = CPU_SETSIZE - 1; cpu < 0 && c >= 0; c--)
+        {
+            if (CPU_ISSET(c, set))
+            {
+                cpu = c;
+            }
+        }
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (sched_setaffinity(0, sizeof(one), &one) == 0)
+        {
+            precision_reserved_cpu = cpu;
+        }
+        else
+        {
+            perror("precision: sched_setaffinity");
+        }
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    {
+        perror("precision: mlockall");
+    }
+    volatile char stack[PRECISION_STACK_PREFAULT];
+    memset((char *)stack, 0, sizeof(stack));
+
+    // Jobs fork from this thread and must not inherit the real-time policy.
+    precision_saved_policy = sched_getscheduler(0);
+    sched_getparam(0, &precision_saved_param);
+    struct sched_param sp = {.sched_priority = precision_rt_priority};
+    if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &sp) < 0)
+    {
+        perror("precision: sched_setscheduler");
+    }
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+}
+
+// The CPUs jobs may run on: the scheduler's mask from before it reserved a
+// core, less that core.
+int precision_job_affinity(cpu_set_t *set)
+{
+    if (precision_reserved_cpu < 0)
+    {
+        return sched_getaffinity(0, sizeof(*set), set);
+    }
+    *set = precision_saved_affinity;
+    CPU_CLR(precision_reserved_cpu, set);
+    return 0;
+}
+
+// In the child, before execvp(): keeps the job off the reserved core.
+void precision_child()
+{
+    if (precision_reserved_cpu < 0)
+    {
+        return;
+    }
+    cpu_set_t set;
+    precision_job_affinity(&set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+void slice_timer_start(SliceTimer *st, uint64_t quantum_ms)
+{
+    st->start_ns = mono_time_ns();
+    st->deadline_ns = st->start_ns + quantum_ms * 1000000ULL;
+}
+
+bool slice_timer_expired(const SliceTimer *st)
+{
+    return mono_time_ns() >= st->deadline_ns;
+}
+
+// Returns early when a signal arrives.
+void precision_sleep_until(uint64_t ns)
+{
+    struct timespec ts = {.tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+// Between polls of a running slice. In precision mode this sleeps until the
+// deadline or the next poll, whichever is first; otherwise it returns at once.
+void slice_timer_wait(const SliceTimer *st)
+{
+    if (!precision_mode)
+    {
+        return;
+    }
+    uint64_t next = mono_time_ns() + PRECISION_POLL_NS;
+    precision_sleep_until(next < st->deadline_ns ? next : st->deadline_ns);
+}
+
+// Right after the job was stopped at the end of a full slice. Every wait
+// loop runs until the deadline has passed, so the error is an overshoot.
+void slice_timer_stopped(const SliceTimer *st)
+{
+    if (!precision_mode && !slice_error_report)
+    {
+        return;
+    }
+    uint64_t now = mono_time_ns();
+    int64_t error_ns = now > st->deadline_ns ? (int64_t)(now - st->deadline_ns) : 0;
+    if (slice_error_count == PRECISION_MAX_SAMPLES)
+    {
+        slice_error_dropped++;
+        return;
+    }
+    slice_error_us[slice_error_count++] = (int32_t)(error_ns / 1000);
+}
+
+int precision_cmp(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void precision_report()
+{
+    if (slice_error_count == 0)
+    {
+        return;
+    }
+    static const int32_t bounds[PRECISION_BUCKETS] = {10, 50, 100, 500, 1000, 5000, INT32_MAX};
+    static const char *labels[PRECISION_BUCKETS] = {"<10us", "<50us", "<100us", "<500us", "<1ms", "<5ms", ">=5ms"};
+    int over[PRECISION_BUCKETS] = {0};
+    for (int i = 0; i < slice_error_count; i++)
+    {
+        int b = 0;
+        while (slice_error_us[i] >= bounds[b])
+        {
+            b++;
+        }
+        over[b]++;
+    }
+
+    qsort(slice_error_us, slice_error_count, sizeof(slice_error_us[0]), precision_cmp);
+    int32_t p50 = slice_error_us[slice_error_count / 2];
+    int32_t p99 = slice_error_us[(slice_error_count * 99) / 100];
+    int32_t max = slice_error_us[slice_error_count - 1];
+
+    printf("\nSlice overshoot over %d slices%s: p50 %d us, p99 %d us, max %d us\n",
+           slice_error_count, precision_mode ? " (precision mode)" : "", p50, p99, max);
+    for (int b = 0; b < PRECISION_BUCKETS; b++)
+    {
+        printf("  %-8s %10d\n", labels[b], over[b]);
+    }
+    if (slice_error_dropped > 0)
+    {
+        printf("  %llu slices not recorded\n", (unsigned long long)slice_error_dropped);
+    }
+    slice_error_count = 0;
+}
+
+// Puts the scheduler back to how precision_begin() found it and reports.
+void precision_end()
+{
+    if (precision_mode)
+    {
+        if (precision_saved_policy >= 0)
+        {
+            sched_setscheduler(0, precision_saved_policy, &precision_saved_param);
+            precision_saved_policy = -1;
+        }
+        if (precision_reserved_cpu >= 0)
+        {
+            sched_setaffinity(0, sizeof(precision_saved_affinity), &precision_saved_affinity);
+            precision_reserved_cpu = -1;
+        }
+        munlockall();
+    }
+    precision_report();
+}
@@ -0,0 +1,397 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "mono_clock.h"
+#include "gang.h"
+
+// ------------------ CONSTANTS ------------------
+#define PREFETCH_RING 64
+#define PREFETCH_RECENT 64
+#define PREFETCH_RECENT_MS 10000
+#define PREFETCH_PATH_MAX 4096
+
+// With prefetch_enabled, a background thread pulls the executables (resolved
+// through PATH, plus a "#!" interpreter) and file arguments of the next
+// prefetch_depth jobs into the page cache, so their exec does not wait on
+// disk. Files are read ahead up to prefetch_max_bytes each.
+bool prefetch_enabled = false;
+int prefetch_depth = 4;
+uint64_t prefetch_max_bytes = 64ULL << 20;
+
+// With exec_latency_enabled, the time from a job's fork until its
+// execvp succeeds is measured through a close-on-exec pipe and reported,
+// split by whether the job was prefetched. Pipelines are left out: their
+// leader never calls exec, so the pipe would only time its fork of the
+// stages.
+bool exec_latency_enabled = false;
+
+typedef struct
+{
+    int fd;
+    uint64_t start_us;
+    bool prefetched;
+} ExecProbe;
+
+uint64_t exec_probe_fork_us = 0;
+
+char *prefetch_ring[PREFETCH_RING];
+int prefetch_head = 0;
+int prefetch_tail = 0;
+bool prefetch_running = false;
+pthread_t prefetch_thread;
+pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+
+uint64_t prefetch_recent_hash[PREFETCH_RECENT];
+uint64_t prefetch_recent_ms[PREFETCH_RECENT];
+int prefetch_recent_next = 0;
+
+int prefetch_files = 0;
+uint64_t prefetch_bytes = 0;
+int prefetch_dropped = 0;
+
+int exec_samples[2] = {0};
+uint64_t exec_latency_sum_us[2] = {0};
+uint64_t exec_latency_max_us[2] = {0};
+
+uint64_t prefetch_hash(const char *s)
+{
+    uint64_t h = 1469598103934665603ULL;
+    while (*s)
+    {
+        h = (h ^ (unsigned char)*s++) * 1099511628211ULL;
+    }
+    return h;
+}
+
+bool prefetch_seen_recently(const char *path)
+{
+    uint64_t h = prefetch_hash(path);
+    uint64_t now = mono_time_ms();
+    for (int i = 0; i < PREFETCH_RECENT; i++)
+    {
+        if (prefetch_recent_hash[i] == h && now - prefetch_recent_ms[i] < PREFETCH_RECENT_MS)
+        {
+            return true;
+        }
+    }
+    prefetch_recent_hash[prefetch_recent_next] = h;
+    prefetch_recent_ms[prefetch_recent_next] = now;
+    prefetch_recent_next = (prefetch_recent_next + 1) % PREFETCH_RECENT;
+    return false;
+}
+
+// Returns the open fd so the caller can look at the file's first bytes.
+int prefetch_file(const char *path)
+{
+    if (prefetch_seen_recently(path))
+    {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return -1;
+    }
+    uint64_t len = (uint64_t)st.st_size;
+    if (len > prefetch_max_bytes)
+    {
+        len = prefetch_max_bytes;
+    }
+    if (readahead(fd, 0, len) < 0)
+    {
+        posix_fadvise(fd, 0, len, POSIX_FADV_WILLNEED);
+    }
+    prefetch_files++;
+    prefetch_bytes += len;
+    return fd;
+}
+
+bool prefetch_resolve(const char *name, char *out, size_t outlen)
+{
+    if (strchr(name, '/') != NULL)
+    {
+        snprintf(out, outlen, "%s", name);
+        return true;
+    }
+    const char *path = getenv("PATH");
+    if (path == NULL)
+    {
+        path = "/usr/local/bin:/usr/bin:/bin";
+    }
+    while (*path)
+    {
+        size_t dir_len = strcspn(path, ":");
+        snprintf(out, outlen, "%.*s/%s", (int)dir_len, dir_len ? path : ".", name);
+        if (access(out, X_OK) == 0)
+        {
+            return true;
+        }
+        path += dir_len;
+        if (*path == ':')
+        {
+            path++;
+        }
+    }
+    return false;
+}
+
+void prefetch_command(char *command)
+{
+    char path[PREFETCH_PATH_MAX];
+    char *save = NULL;
+    char *arg = strtok_r(command, " \t\n", &save);
+    if (arg == NULL)
+    {
+        return;
+    }
+
+    if (prefetch_resolve(arg, path, sizeof(path)))
+    {
+        int fd = prefetch_file(path);
+        if (fd >= 0)
+        {
+            char head[256];
+            ssize_t got = pread(fd, head, sizeof(head) - 1, 0);
+            close(fd);
+            if (got > 2 && head[0] == '#' && head[1] == '!')
+            {
+                head[got] = '\0';
+                char *interp = head + 2 + strspn(head + 2, " \t");
+                interp[strcspn(interp, " \t\r\n")] = '\0';
+                fd = prefetch_file(interp);
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        }
+    }
+
+    while ((arg = strtok_r(NULL, " \t\n", &save)) != NULL)
+    {
+        if (arg[0] == '-')
+        {
+            continue;
+        }
+        int fd = prefetch_file(arg);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void *prefetch_main(void *arg)
+{
+    pthread_mutex_lock(&prefetch_lock);
+    while (1)
+    {
+        while (prefetch_running && prefetch_head == prefetch_tail)
+        {
+            pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+        }
+        if (!prefetch_running)
+        {
+            break;
+        }
+        char *command = prefetch_ring[prefetch_tail];
+        prefetch_tail = (prefetch_tail + 1) % PREFETCH_RING;
+        pthread_mutex_unlock(&prefetch_lock);
+
+        prefetch_command(command);
+        free(command);
+
+        pthread_mutex_lock(&prefetch_lock);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+    return NULL;
+}
+
+void prefetch_begin()
+{
+    prefetch_files = 0;
+    prefetch_bytes = 0;
+    prefetch_dropped = 0;
+    memset(exec_samples, 0, sizeof(exec_samples));
+    memset(exec_latency_sum_us, 0, sizeof(exec_latency_sum_us));
+    memset(exec_latency_max_us, 0, sizeof(exec_latency_max_us));
+    if (!prefetch_enabled)
+    {
+        return;
+    }
+    prefetch_head = prefetch_tail = 0;
+    prefetch_running = true;
+    if (pthread_create(&prefetch_thread, NULL, prefetch_main, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        prefetch_running = false;
+    }
+}
+
+// Queues a command for prefetching; never blocks the dispatch loop.
+void prefetch_hint(const char *command)
+{
+    if (!prefetch_running)
+    {
+        return;
+    }
+    pthread_mutex_lock(&prefetch_lock);
+    int next = (prefetch_head + 1) % PREFETCH_RING;
+    if (next == prefetch_tail)
+    {
+        prefetch_dropped++;
+    }
+    else
+    {
+        prefetch_ring[prefetch_head] = strdup(command);
+        prefetch_head = next;
+        pthread_cond_signal(&prefetch_cond);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+void prefetch_end()
+{
+    if (prefetch_running)
+    {
+        pthread_mutex_lock(&prefetch_lock);
+        prefetch_running = false;
+        pthread_cond_signal(&prefetch_cond);
+        pthread_mutex_unlock(&prefetch_lock);
+        pthread_join(prefetch_thread, NULL);
+        while (prefetch_tail != prefetch_head)
+        {
+            free(prefetch_ring[prefetch_tail]);
+            prefetch_tail = (prefetch_tail + 1) % PREFETCH_RING;
+        }
+    }
+}
+
+// Called in the parent right after fork(); fds come from exec_probe_pipe().
+void exec_probe_parent(ExecProbe *ep, int fds[2], bool prefetched)
+{
+    ep->fd = -1;
+    if (fds[0] < 0)
+    {
+        return;
+    }
+    close(fds[1]);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    ep->fd = fds[0];
+    ep->start_us = exec_probe_fork_us;
+    ep->prefetched = prefetched;
+}
+
+// Right before fork(). The sample starts here rather than at the first
+// SIGCONT, since a fast exec can finish before the job is first stopped.
+void exec_probe_pipe(int fds[2], const char *command)
+{
+    fds[0] = fds[1] = -1;
+    if (exec_latency_enabled && !gang_is_pipeline(command) && pipe2(fds, O_CLOEXEC) < 0)
+    {
+        fds[0] = fds[1] = -1;
+    }
+    exec_probe_fork_us = mono_time_us();
+}
+
+void exec_probe_abandon(int fds[2])
+{
+    if (fds[0] >= 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+}
+
+// In the child just before _exit() when execvp failed.
+void exec_probe_failed(int fds[2])
+{
+    if (fds[1] >= 0)
+    {
+        // A lost byte only reads as a successful exec; the child exits anyway.
+        ssize_t ignored = write(fds[1], "x", 1);
+        (void)ignored;
+    }
+}
+
+// Records the sample once the pipe closes on a successful exec.
+void exec_probe_poll(ExecProbe *ep)
+{
+    if (ep->fd < 0)
+    {
+        return;
+    }
+    char c;
+    ssize_t got = read(ep->fd, &c, 1);
+    if (got < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return;
+    }
+    if (got == 0)
+    {
+        uint64_t us = mono_time_us() - ep->start_us;
+        exec_samples[ep->prefetched]++;
+        exec_latency_sum_us[ep->prefetched] += us;
+        if (us > exec_latency_max_us[ep->prefetched])
+        {
+            exec_latency_max_us[ep->prefetched] = us;
+        }
+    }
+    close(ep->fd);
+    ep->fd = -1;
+}
+
+void exec_probe_wait(ExecProbe *ep, int timeout_ms)
+{
+    if (ep->fd < 0)
+    {
+        return;
+    }
+    struct pollfd pfd = {.fd = ep->fd, .events = POLLIN};
+    poll(&pfd, 1, timeout_ms);
+    exec_probe_poll(ep);
+}
+
+void prefetch_report()
+{
+    if (prefetch_enabled)
+    {
+        printf("\nPrefetch: %d files, %llu KB read ahead, %d hints dropped\n",
+               prefetch_files, (unsigned long long)(prefetch_bytes >> 10), prefetch_dropped);
+    }
+    if (!exec_latency_enabled)
+    {
+        return;
+    }
+    const char *label[2] = {"not prefetched", "prefetched"};
+    for (int i = 0; i < 2; i++)
+    {
+        if (exec_samples[i] > 0)
+        {
+            printf("Exec latency (%s): %d jobs, mean %.2f ms, max %.2f ms\n",
+                   label[i], exec_samples[i],
+                   exec_latency_sum_us[i] / 1000.0 / exec_samples[i],
+                   exec_latency_max_us[i] / 1000.0);
+        }
+    }
+}
@@ -0,0 +1,467 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "mono_clock.h"
+
+// ------------------ CONSTANTS ------------------
+#define SHM_MAGIC 0x53434846u
+#define SHM_MAGIC_INIT 1u
+#define SHM_INIT_WAIT_MS 1000
+#define SHM_JOB_SLOTS 1024
+#define SHM_CMD_MAX 512
+#define SHM_BURST_CMDS 1024
+#define SHM_HIST 50
+#define SHM_REAP_MS 500
+
+// Job slot states. A slot moves FREE -> FILLING -> PENDING -> CLAIMED and
+// back to FREE when the claiming instance finishes the job. A submitter
+// takes a slot by setting its owner from 0 to itself before FILLING and
+// clears it again once the slot is PENDING; a claimer sets the owner and
+// records the job's process once it forks, so survivors can take over the
+// slots of a dead instance and kill the jobs it left behind. Owners and job
+// processes are stored as shm_proc_id() values, so a recycled pid is never
+// taken for the process that was recorded.
+enum
+{
+    SHM_SLOT_FREE,
+    SHM_SLOT_FILLING,
+    SHM_SLOT_PENDING,
+    SHM_SLOT_CLAIMED
+};
+
+typedef struct
+{
+    atomic_int state;
+    atomic_ullong owner;
+    atomic_ullong pid;
+    int job_id;
+    uint64_t ticket;
+    uint64_t submit_time_ms;
+    char command[SHM_CMD_MAX];
+} ShmJob;
+
+// Per-command burst statistics, the shared counterpart of burst_hist /
+// burst_sum / burst_count. Entries are never removed. Each takes a robust
+// process-shared mutex, so an instance dying while holding it does not
+// block the others.
+typedef struct
+{
+    atomic_int used;
+    pthread_mutex_t lock;
+    char command[SHM_CMD_MAX];
+    int count;
+    double sum;
+    double hist[SHM_HIST];
+} ShmBurst;
+
+typedef struct
+{
+    atomic_uint magic;
+    atomic_int next_job_id;
+    atomic_ullong submit_ticket;
+    atomic_uint claim_hint;
+    ShmJob jobs[SHM_JOB_SLOTS];
+    ShmBurst burst[SHM_BURST_CMDS];
+} ShmSegment;
+
+// Name passed to shm_open(), e.g. "/scheduler_jobs". NULL keeps every
+// scheduler instance private.
+const char *shared_segment_name = NULL;
+ShmSegment *shm_segment = NULL;
+uint64_t shm_self = 0;
+uint64_t shm_last_reap_ms = 0;
+
+// Start time of a process in clock ticks since boot (/proc/<pid>/stat field
+// 22), or 0 when it cannot be read.
+uint64_t shm_proc_start(int pid)
+{
+    char path[64];
+    char buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[len] = '\0';
+
+    // The scan starts at field 3 (state), after the parenthesised name.
+    char *p = strrchr(buf, ')');
+    if (p == NULL)
+    {
+        return 0;
+    }
+    p += 2;
+    for (int field = 3; field < 22 && p != NULL; field++)
+    {
+        p = strchr(p, ' ');
+        if (p != NULL)
+        {
+            p++;
+        }
+    }
+    return p != NULL ? strtoull(p, NULL, 10) : 0;
+}
+
+// A pid in the low 32 bits and the low 32 bits of its start time above it.
+// Without /proc the start time is 0 and only the pid is compared.
+uint64_t shm_proc_id(int pid)
+{
+    return ((uint64_t)(uint32_t)shm_proc_start(pid) << 32) | (uint32_t)pid;
+}
+
+bool shm_proc_alive(uint64_t id)
+{
+    int pid = (int)(uint32_t)id;
+    if (id == 0)
+    {
+        return false;
+    }
+    if ((id >> 32) == 0)
+    {
+        return kill(pid, 0) == 0 || errno != ESRCH;
+    }
+    return shm_proc_id(pid) == id;
+}
+
+int shm_attach(const char *name)
+{
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        perror("shm_open failed");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (st.st_size < (off_t)sizeof(ShmSegment) && ftruncate(fd, sizeof(ShmSegment)) < 0))
+    {
+        perror("shm resize failed");
+        close(fd);
+        return -1;
+    }
+    void *mem = mmap(NULL, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        perror("shm mmap failed");
+        return -1;
+    }
+
+    // ftruncate zero-fills; the first instance only has to set up the locks.
+    shm_segment = mem;
+    unsigned int expected = 0;
+    if (atomic_compare_exchange_strong(&shm_segment->magic, &expected, SHM_MAGIC_INIT))
+    {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        for (int i = 0; i < SHM_BURST_CMDS; i++)
+        {
+            pthread_mutex_init(&shm_segment->burst[i].lock, &attr);
+        }
+        pthread_mutexattr_destroy(&attr);
+        atomic_store(&shm_segment->magic, SHM_MAGIC);
+    }
+    shm_self = shm_proc_id((int)getpid());
+    for (int waited = 0; atomic_load(&shm_segment->magic) == SHM_MAGIC_INIT && waited < SHM_INIT_WAIT_MS; waited++)
+    {
+        usleep(1000);
+    }
+    if (atomic_load(&shm_segment->magic) != SHM_MAGIC)
+    {
+        fprintf(stderr, "shared segment %s has an unknown layout\n", name);
+        munmap(mem, sizeof(ShmSegment));
+        shm_segment = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void shm_detach()
+{
+    if (shm_segment != NULL)
+    {
+        munmap(shm_segment, sizeof(ShmSegment));
+        shm_segment = NULL;
+    }
+}
+
+int shm_next_job_id()
+{
+    return atomic_fetch_add(&shm_segment->next_job_id, 1);
+}
+
+// Publishes a job for any attached instance to claim. submit_time_ms is a
+// wall-clock timestamp so every instance can derive the job's arrival.
+// Returns the job id, or -1 when every slot is in use.
+int shm_submit(const char *command, int job_id, uint64_t submit_time_ms)
+{
+    uint64_t ticket = atomic_fetch_add(&shm_segment->submit_ticket, 1);
+    for (int probe = 0; probe < SHM_JOB_SLOTS; probe++)
+    {
+        ShmJob *job = &shm_segment->jobs[(ticket + probe) % SHM_JOB_SLOTS];
+        uint64_t owner = 0;
+        if (!atomic_compare_exchange_strong(&job->owner, &owner, shm_self))
+        {
+            continue;
+        }
+        int expected = SHM_SLOT_FREE;
+        if (!atomic_compare_exchange_strong(&job->state, &expected, SHM_SLOT_FILLING))
+        {
+            atomic_store(&job->owner, 0);
+            continue;
+        }
+        atomic_store(&job->pid, 0);
+        job->job_id = job_id;
+        job->ticket = ticket;
+        job->submit_time_ms = submit_time_ms;
+        strncpy(job->command, command, SHM_CMD_MAX - 1);
+        job->command[SHM_CMD_MAX - 1] = '\0';
+        atomic_store_explicit(&job->state, SHM_SLOT_PENDING, memory_order_release);
+        // A claimer may already have replaced the owner; then it stays.
+        owner = shm_self;
+        atomic_compare_exchange_strong(&job->owner, &owner, 0);
+        return job_id;
+    }
+    return -1;
+}
+
+// Claims one pending job for this instance. On success the command is
+// copied out and the slot index is returned so it can be released later.
+int shm_claim(char *command, size_t len, int *job_id, uint64_t *submit_time_ms)
+{
+    unsigned int start = atomic_load(&shm_segment->claim_hint);
+    for (int probe = 0; probe < SHM_JOB_SLOTS; probe++)
+    {
+        int slot = (int)((start + probe) % SHM_JOB_SLOTS);
+        ShmJob *job = &shm_segment->jobs[slot];
+        int expected = SHM_SLOT_PENDING;
+        if (atomic_load_explicit(&job->state, memory_order_acquire) != SHM_SLOT_PENDING ||
+            !atomic_compare_exchange_strong(&job->state, &expected, SHM_SLOT_CLAIMED))
+        {
+            continue;
+        }
+        atomic_store(&job->owner, shm_self);
+        atomic_store(&job->pid, 0);
+        strncpy(command, job->command, len - 1);
+        command[len - 1] = '\0';
+        *job_id = job->job_id;
+        *submit_time_ms = job->submit_time_ms;
+        atomic_store(&shm_segment->claim_hint, (unsigned int)(slot + 1));
+        return slot;
+    }
+    return -1;
+}
+
+// Right after a claimed job is forked.
+void shm_job_started(int slot, pid_t pid)
+{
+    if (slot >= 0 && shm_segment != NULL)
+    {
+        atomic_store(&shm_segment->jobs[slot].pid, shm_proc_id((int)pid));
+    }
+}
+
+void shm_release(int slot, bool completed)
+{
+    if (slot < 0)
+    {
+        return;
+    }
+    ShmJob *job = &shm_segment->jobs[slot];
+    atomic_store(&job->pid, 0);
+    if (!completed)
+    {
+        atomic_store(&job->state, SHM_SLOT_PENDING);
+        uint64_t owner = shm_self;
+        atomic_compare_exchange_strong(&job->owner, &owner, 0);
+        return;
+    }
+    atomic_store(&job->state, SHM_SLOT_FREE);
+    atomic_store(&job->owner, 0);
+}
+
+bool shm_owner_dead(uint64_t owner)
+{
+    return owner != 0 && !shm_proc_alive(owner);
+}
+
+// A job left by a dead instance may still be stopped; it is rerun from the
+// start by whoever claims the slot next, so it is killed rather than resumed.
+// Nothing is sent when the recorded process is gone, even if its pid has
+// been reused since.
+void shm_kill_orphan(ShmJob *job)
+{
+    uint64_t id = atomic_exchange(&job->pid, 0);
+    if (!shm_proc_alive(id))
+    {
+        return;
+    }
+    int pid = (int)(uint32_t)id;
+    if (getpgid(pid) == pid)
+    {
+        kill(-pid, SIGKILL);
+    }
+    else
+    {
+        kill(pid, SIGKILL);
+    }
+}
+
+// Hands jobs claimed (or half-submitted) by instances that no longer exist
+// back to the pool. Rate limited to one pass per SHM_REAP_MS.
+void shm_reap_dead_owners()
+{
+    uint64_t now = mono_time_ms();
+    if (now - shm_last_reap_ms < SHM_REAP_MS)
+    {
+        return;
+    }
+    shm_last_reap_ms = now;
+
+    for (int slot = 0; slot < SHM_JOB_SLOTS; slot++)
+    {
+        ShmJob *job = &shm_segment->jobs[slot];
+        int state = atomic_load(&job->state);
+        uint64_t owner = atomic_load(&job->owner);
+        if (state == SHM_SLOT_PENDING || !shm_owner_dead(owner))
+        {
+            continue;
+        }
+        if (state == SHM_SLOT_CLAIMED)
+        {
+            shm_kill_orphan(job);
+            atomic_compare_exchange_strong(&job->state, &state, SHM_SLOT_PENDING);
+        }
+        else if (state == SHM_SLOT_FILLING)
+        {
+            if (atomic_compare_exchange_strong(&job->state, &state, SHM_SLOT_FREE))
+            {
+                atomic_compare_exchange_strong(&job->owner, &owner, 0);
+            }
+        }
+        else
+        {
+            // Died between taking the owner and FILLING, or while releasing.
+            atomic_compare_exchange_strong(&job->owner, &owner, 0);
+        }
+    }
+}
+
+void shm_lock(pthread_mutex_t *lock)
+{
+    if (pthread_mutex_lock(lock) == EOWNERDEAD)
+    {
+        pthread_mutex_consistent(lock);
+    }
+}
+
+// An entry's command is written under its lock before used is set, so a
+// set used always means a complete command.
+ShmBurst *shm_burst_lookup(const char *command, bool create)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (const char *c = command; *c; c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    for (int probe = 0; probe < SHM_BURST_CMDS; probe++)
+    {
+        ShmBurst *entry = &shm_segment->burst[(hash + probe) % SHM_BURST_CMDS];
+        if (atomic_load_explicit(&entry->used, memory_order_acquire) == 0)
+        {
+            if (!create)
+            {
+                return NULL;
+            }
+            shm_lock(&entry->lock);
+            bool created = atomic_load(&entry->used) == 0;
+            if (created)
+            {
+                strncpy(entry->command, command, SHM_CMD_MAX - 1);
+                entry->command[SHM_CMD_MAX - 1] = '\0';
+                atomic_store_explicit(&entry->used, 1, memory_order_release);
+            }
+            pthread_mutex_unlock(&entry->lock);
+            if (created)
+            {
+                return entry;
+            }
+        }
+        if (strncmp(entry->command, command, SHM_CMD_MAX - 1) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void shm_burst_register(const char *command, double burst)
+{
+    ShmBurst *entry = shm_burst_lookup(command, true);
+    if (entry == NULL)
+    {
+        return;
+    }
+    shm_lock(&entry->lock);
+    entry->hist[entry->count % SHM_HIST] = burst;
+    entry->sum += burst;
+    entry->count++;
+    pthread_mutex_unlock(&entry->lock);
+}
+
+// Mean of the last k bursts (k <= 0 means all of them, as avg_burst does).
+// Returns -1 when the command has no history yet.
+double shm_burst_estimate(const char *command, int k)
+{
+    ShmBurst *entry = shm_burst_lookup(command, false);
+    if (entry == NULL)
+    {
+        return -1.0;
+    }
+    double result = -1.0;
+    shm_lock(&entry->lock);
+    if (entry->count > 0)
+    {
+        if (k <= 0)
+        {
+            result = entry->sum / entry->count;
+        }
+        else
+        {
+            int total = entry->count;
+            int start = total > k ? total - k : 0;
+            if (total - start > SHM_HIST)
+            {
+                start = total - SHM_HIST;
+            }
+            double sum = 0.0;
+            for (int i = start; i < total; i++)
+            {
+                sum += entry->hist[i % SHM_HIST];
+            }
+            result = sum / (total - start);
+        }
+    }
+    pthread_mutex_unlock(&entry->lock);
+    return result;
+}
@@ -0,0 +1,325 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// ------------------ CONSTANTS ------------------
+#define SUBMIT_MAX_CLIENTS 64
+#define SUBMIT_LINE_MAX 4096
+#define SUBMIT_POLL_MS 100
+
+// Intrusive multi-producer / single-consumer queue (Vyukov). Producers only
+// do one atomic exchange, the dispatch loop is the single consumer.
+typedef struct SubmitNode
+{
+    _Atomic(struct SubmitNode *) next;
+    char *command;
+    int job_id;
+} SubmitNode;
+
+typedef struct
+{
+    _Atomic(SubmitNode *) head;
+    SubmitNode *tail;
+    SubmitNode stub;
+} SubmitQueue;
+
+SubmitQueue submit_queue;
+atomic_int submit_job_seq = 0;
+atomic_int *submit_job_seq_ptr = &submit_job_seq;
+// Jobs the process table can still take. A line is acknowledged only after
+// it reserves one of them, and refused with ERR when none are left.
+atomic_int submit_slots_left = INT_MAX;
+atomic_bool submit_running = false;
+int submit_listen_fd = -1;
+pthread_t submit_thread;
+
+int submit_next_job_id()
+{
+    return atomic_fetch_add(submit_job_seq_ptr, 1);
+}
+
+bool submit_reserve_slot()
+{
+    int left = atomic_load(&submit_slots_left);
+    while (left > 0)
+    {
+        if (atomic_compare_exchange_weak(&submit_slots_left, &left, left - 1))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void submit_release_slot()
+{
+    atomic_fetch_add(&submit_slots_left, 1);
+}
+
+void submit_queue_init(SubmitQueue *q)
+{
+    atomic_store(&q->stub.next, NULL);
+    atomic_store(&q->head, &q->stub);
+    q->tail = &q->stub;
+}
+
+void submit_queue_push(SubmitQueue *q, SubmitNode *node)
+{
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    SubmitNode *prev = atomic_exchange_explicit(&q->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+SubmitNode *submit_queue_pop(SubmitQueue *q)
+{
+    SubmitNode *tail = q->tail;
+    SubmitNode *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    if (tail == &q->stub)
+    {
+        if (next == NULL)
+        {
+            return NULL;
+        }
+        q->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+    if (next != NULL)
+    {
+        q->tail = next;
+        return tail;
+    }
+    // A producer has swapped head but not linked yet; try again next poll.
+    if (tail != atomic_load_explicit(&q->head, memory_order_acquire))
+    {
+        return NULL;
+    }
+    submit_queue_push(q, &q->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next != NULL)
+    {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+void submit_line(int client_fd, char *line)
+{
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' '))
+    {
+        line[--len] = '\0';
+    }
+    char *cmd = line;
+    while (*cmd == ' ' || *cmd == '\t')
+    {
+        cmd++;
+    }
+    if (*cmd == '\0')
+    {
+        return;
+    }
+
+    if (!submit_reserve_slot())
+    {
+        dprintf(client_fd, "ERR scheduler full\n");
+        return;
+    }
+    SubmitNode *node = malloc(sizeof(SubmitNode));
+    if (node == NULL)
+    {
+        submit_release_slot();
+        dprintf(client_fd, "ERR out of memory\n");
+        return;
+    }
+    node->command = strdup(cmd);
+    if (node->command == NULL)
+    {
+        free(node);
+        submit_release_slot();
+        dprintf(client_fd, "ERR out of memory\n");
+        return;
+    }
+    // The dispatch loop frees the node once it is pushed.
+    int job_id = submit_next_job_id();
+    node->job_id = job_id;
+    submit_queue_push(&submit_queue, node);
+
+    dprintf(client_fd, "OK %d\n", job_id);
+}
+
+void *submit_intake_main(void *arg)
+{
+    struct pollfd fds[SUBMIT_MAX_CLIENTS + 1];
+    static char bufs[SUBMIT_MAX_CLIENTS + 1][SUBMIT_LINE_MAX];
+    int lens[SUBMIT_MAX_CLIENTS + 1] = {0};
+    // Set after a line overflowed the buffer: input is dropped up to the
+    // next newline so the tail is not taken for a command of its own.
+    bool discarding[SUBMIT_MAX_CLIENTS + 1] = {0};
+    int nfds = 1;
+
+    fds[0].fd = submit_listen_fd;
+    fds[0].events = POLLIN;
+
+    while (atomic_load(&submit_running))
+    {
+        // With the client table full the listener is left out of the poll
+        // (poll skips negative fds); connections wait in the backlog until a
+        // client leaves.
+        bool full = nfds > SUBMIT_MAX_CLIENTS;
+        fds[0].fd = full ? -1 : submit_listen_fd;
+        if (poll(fds, nfds, SUBMIT_POLL_MS) <= 0)
+        {
+            continue;
+        }
+
+        if (!full && (fds[0].revents & POLLIN))
+        {
+            int cfd = accept4(submit_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (cfd >= 0)
+            {
+                fds[nfds].fd = cfd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                lens[nfds] = 0;
+                discarding[nfds] = false;
+                nfds++;
+            }
+        }
+
+        for (int c = 1; c < nfds; c++)
+        {
+            if (!(fds[c].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+
+            ssize_t got = read(fds[c].fd, bufs[c] + lens[c], SUBMIT_LINE_MAX - 1 - lens[c]);
+            if (got < 0 && (errno == EAGAIN || errno == EINTR))
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                close(fds[c].fd);
+                nfds--;
+                fds[c] = fds[nfds];
+                memcpy(bufs[c], bufs[nfds], lens[nfds]);
+                lens[c] = lens[nfds];
+                discarding[c] = discarding[nfds];
+                c--;
+                continue;
+            }
+            lens[c] += got;
+
+            int consumed = 0;
+            if (discarding[c])
+            {
+                char *nl = memchr(bufs[c], '\n', lens[c]);
+                if (nl == NULL)
+                {
+                    lens[c] = 0;
+                    continue;
+                }
+                consumed = (int)(nl - bufs[c]) + 1;
+                discarding[c] = false;
+            }
+            for (int j = consumed; j < lens[c]; j++)
+            {
+                if (bufs[c][j] == '\n')
+                {
+                    bufs[c][j] = '\0';
+                    submit_line(fds[c].fd, bufs[c] + consumed);
+                    consumed = j + 1;
+                }
+            }
+            if (consumed == 0 && lens[c] == SUBMIT_LINE_MAX - 1)
+            {
+                dprintf(fds[c].fd, "ERR line too long\n");
+                consumed = lens[c];
+                discarding[c] = true;
+            }
+            memmove(bufs[c], bufs[c] + consumed, lens[c] - consumed);
+            lens[c] -= consumed;
+        }
+    }
+
+    for (int c = 1; c < nfds; c++)
+    {
+        close(fds[c].fd);
+    }
+    return NULL;
+}
+
+int submit_start(const char *path)
+{
+    struct sockaddr_un addr;
+    submit_queue_init(&submit_queue);
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "submit socket path too long: %s\n", path);
+        return -1;
+    }
+
+    submit_listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (submit_listen_fd < 0)
+    {
+        perror("socket failed");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if (bind(submit_listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(submit_listen_fd, SUBMIT_MAX_CLIENTS) < 0)
+    {
+        perror("submit socket bind failed");
+        close(submit_listen_fd);
+        submit_listen_fd = -1;
+        return -1;
+    }
+
+    atomic_store(&submit_running, true);
+    if (pthread_create(&submit_thread, NULL, submit_intake_main, NULL) != 0)
+    {
+        perror("pthread_create failed");
+        atomic_store(&submit_running, false);
+        close(submit_listen_fd);
+        submit_listen_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void submit_stop(const char *path)
+{
+    if (!atomic_load(&submit_running))
+    {
+        return;
+    }
+    atomic_store(&submit_running, false);
+    pthread_join(submit_thread, NULL);
+    close(submit_listen_fd);
+    submit_listen_fd = -1;
+    unlink(path);
+}
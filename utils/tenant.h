@@ -0,0 +1,280 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "level_queue.h"
+
+// ------------------ CONSTANTS ------------------
+#define MAX_TENANTS 64
+#define TENANT_NAME_MAX 32
+
+// Weighted fair share between tenants: every tenant accumulates CPU time
+// divided by its share, and the tenant with the least of it runs next. The
+// tenants with unfinished jobs sit in a binary min-heap keyed by that value,
+// so a decision is O(log tenants).
+typedef struct
+{
+    char name[TENANT_NAME_MAX];
+    int share;
+    double vtime;
+    int pending;
+    int heap_pos;
+    bool has_queues;
+    LevelQueues queues;
+    uint64_t cpu_ms;
+    int jobs_done;
+    uint64_t response_sum;
+    uint64_t response_max;
+    uint64_t turnaround_sum;
+} Tenant;
+
+bool tenant_fair_share = false;
+Tenant tenants[MAX_TENANTS];
+int tenant_count = 0;
+int tenant_heap[MAX_TENANTS];
+int tenant_heap_size = 0;
+double tenant_vclock = 0.0;
+
+void tenant_reset()
+{
+    for (int t = 0; t < tenant_count; t++)
+    {
+        if (tenants[t].has_queues)
+        {
+            lq_free(&tenants[t].queues);
+        }
+    }
+    memset(tenants, 0, sizeof(tenants));
+    tenant_count = 0;
+    tenant_heap_size = 0;
+    tenant_vclock = 0.0;
+}
+
+void tenant_heap_swap(int a, int b)
+{
+    int ta = tenant_heap[a];
+    int tb = tenant_heap[b];
+    tenant_heap[a] = tb;
+    tenant_heap[b] = ta;
+    tenants[tb].heap_pos = a;
+    tenants[ta].heap_pos = b;
+}
+
+void tenant_sift_up(int pos)
+{
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (tenants[tenant_heap[parent]].vtime <= tenants[tenant_heap[pos]].vtime)
+        {
+            break;
+        }
+        tenant_heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+void tenant_sift_down(int pos)
+{
+    while (1)
+    {
+        int best = pos;
+        int l = 2 * pos + 1;
+        int r = l + 1;
+        if (l < tenant_heap_size && tenants[tenant_heap[l]].vtime < tenants[tenant_heap[best]].vtime)
+        {
+            best = l;
+        }
+        if (r < tenant_heap_size && tenants[tenant_heap[r]].vtime < tenants[tenant_heap[best]].vtime)
+        {
+            best = r;
+        }
+        if (best == pos)
+        {
+            return;
+        }
+        tenant_heap_swap(pos, best);
+        pos = best;
+    }
+}
+
+// Returns the tenant's id, creating it on first use. An empty name is the
+// "default" tenant; share <= 0 keeps the tenant's current share.
+int tenant_lookup(const char *name, int share)
+{
+    if (name == NULL || name[0] == '\0')
+    {
+        name = "default";
+    }
+    int t = 0;
+    while (t < tenant_count && strcmp(tenants[t].name, name) != 0)
+    {
+        t++;
+    }
+    if (t == tenant_count)
+    {
+        if (tenant_count == MAX_TENANTS)
+        {
+            fprintf(stderr, "too many tenants, %s runs as %s\n", name, tenants[0].name);
+            return 0;
+        }
+        strncpy(tenants[t].name, name, TENANT_NAME_MAX - 1);
+        tenants[t].share = 1;
+        tenants[t].heap_pos = -1;
+        tenant_count++;
+    }
+    if (share > 0)
+    {
+        tenants[t].share = share;
+    }
+    return t;
+}
+
+// A tenant that was idle rejoins at the current virtual clock so it cannot
+// bank credit while it had nothing to run.
+void tenant_job_added(int t)
+{
+    if (tenants[t].pending++ > 0)
+    {
+        return;
+    }
+    if (tenants[t].vtime < tenant_vclock)
+    {
+        tenants[t].vtime = tenant_vclock;
+    }
+    tenants[t].heap_pos = tenant_heap_size;
+    tenant_heap[tenant_heap_size++] = t;
+    tenant_sift_up(tenants[t].heap_pos);
+}
+
+void tenant_job_done(int t)
+{
+    if (--tenants[t].pending > 0)
+    {
+        return;
+    }
+    int pos = tenants[t].heap_pos;
+    tenant_heap_size--;
+    if (pos != tenant_heap_size)
+    {
+        tenant_heap_swap(pos, tenant_heap_size);
+        int moved = tenant_heap[pos];
+        tenant_sift_up(pos);
+        tenant_sift_down(tenants[moved].heap_pos);
+    }
+    tenants[t].heap_pos = -1;
+}
+
+void tenant_charge(int t, uint64_t ms)
+{
+    tenants[t].cpu_ms += ms;
+    tenants[t].vtime += (double)ms / tenants[t].share;
+    if (tenants[t].heap_pos >= 0)
+    {
+        tenant_sift_down(tenants[t].heap_pos);
+    }
+}
+
+void tenant_record(int t, uint64_t turnaround, uint64_t response)
+{
+    tenants[t].jobs_done++;
+    tenants[t].turnaround_sum += turnaround;
+    tenants[t].response_sum += response;
+    if (response > tenants[t].response_max)
+    {
+        tenants[t].response_max = response;
+    }
+}
+
+// A tenant whose level queues are empty has all of its jobs running or held
+// back by admission control, so there is nothing of it to dispatch.
+bool tenant_has_queued(int t)
+{
+    return !tenants[t].has_queues || !lq_empty(&tenants[t].queues);
+}
+
+// Tenant with queued jobs and the least weighted CPU time, or -1. The heap
+// root is almost always it; when the root has nothing queued the rest of the
+// heap is scanned.
+int tenant_next()
+{
+    if (tenant_heap_size == 0)
+    {
+        return -1;
+    }
+    int t = tenant_heap[0];
+    tenant_vclock = tenants[t].vtime;
+    if (tenant_has_queued(t))
+    {
+        return t;
+    }
+    int best = -1;
+    for (int pos = 1; pos < tenant_heap_size; pos++)
+    {
+        int c = tenant_heap[pos];
+        if (tenant_has_queued(c) && (best == -1 || tenants[c].vtime < tenants[best].vtime))
+        {
+            best = c;
+        }
+    }
+    return best;
+}
+
+LevelQueues *tenant_queues(int t, int levels, int capacity)
+{
+    if (!tenants[t].has_queues)
+    {
+        if (lq_init(&tenants[t].queues, levels, capacity) < 0)
+        {
+            return NULL;
+        }
+        tenants[t].has_queues = true;
+    }
+    return &tenants[t].queues;
+}
+
+void tenant_report(const char *path)
+{
+    uint64_t total_cpu = 0;
+    for (int t = 0; t < tenant_count; t++)
+    {
+        total_cpu += tenants[t].cpu_ms;
+    }
+    if (tenant_count == 0)
+    {
+        return;
+    }
+
+    FILE *csv = path != NULL ? fopen(path, "w") : NULL;
+    if (csv != NULL)
+    {
+        fprintf(csv, "tenant,share,jobs,cpu_ms,cpu_share,mean_response_ms,max_response_ms,mean_turnaround_ms\n");
+    }
+    printf("\nTenants:\n");
+    for (int t = 0; t < tenant_count; t++)
+    {
+        Tenant *tn = &tenants[t];
+        double cpu_share = total_cpu ? (double)tn->cpu_ms / total_cpu : 0.0;
+        double mean_response = tn->jobs_done ? (double)tn->response_sum / tn->jobs_done : 0.0;
+        double mean_turnaround = tn->jobs_done ? (double)tn->turnaround_sum / tn->jobs_done : 0.0;
+
+        printf("  %s: share %d, %d jobs, %llu ms CPU (%.1f%%), response mean %.1f ms max %llu ms\n",
+               tn->name, tn->share, tn->jobs_done,
+               (unsigned long long)tn->cpu_ms, cpu_share * 100.0,
+               mean_response, (unsigned long long)tn->response_max);
+        if (csv != NULL)
+        {
+            fprintf(csv, "%s,%d,%d,%llu,%.4f,%.1f,%llu,%.1f\n",
+                    tn->name, tn->share, tn->jobs_done,
+                    (unsigned long long)tn->cpu_ms, cpu_share,
+                    mean_response, (unsigned long long)tn->response_max, mean_turnaround);
+        }
+    }
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// ------------------ CONSTANTS ------------------
+#define TW_BITS 6
+#define TW_SIZE (1 << TW_BITS)
+#define TW_MASK (TW_SIZE - 1)
+#define TW_LEVELS 4
+#define TW_SPAN (1ULL << (TW_BITS * TW_LEVELS))
+
+// Hierarchical timing wheel with 1 ms ticks: level l holds timers due within
+// 64^(l+1) ticks, and a level's slot is cascaded into the level below when
+// the wheel reaches it. Adding and cancelling a timer are O(1).
+typedef struct TimerNode
+{
+    struct TimerNode *next;
+    struct TimerNode **pprev;
+    uint64_t expires;
+    void *data;
+} TimerNode;
+
+typedef struct
+{
+    uint64_t now;
+    int count;
+    TimerNode *slots[TW_LEVELS][TW_SIZE];
+} TimerWheel;
+
+typedef void (*TimerFn)(TimerNode *node);
+
+void tw_init(TimerWheel *w, uint64_t now)
+{
+    memset(w, 0, sizeof(*w));
+    w->now = now;
+}
+
+bool tw_pending(const TimerNode *node)
+{
+    return node->pprev != NULL;
+}
+
+void tw_link(TimerWheel *w, TimerNode *node)
+{
+    uint64_t expires = node->expires < w->now ? w->now : node->expires;
+    uint64_t delta = expires - w->now;
+    if (delta >= TW_SPAN)
+    {
+        // Parked in the top level; fires early there and is linked again.
+        expires = w->now + TW_SPAN - 1;
+        delta = TW_SPAN - 1;
+    }
+
+    int level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1ULL << (TW_BITS * (level + 1))))
+    {
+        level++;
+    }
+    TimerNode **head = &w->slots[level][(expires >> (TW_BITS * level)) & TW_MASK];
+
+    node->next = *head;
+    if (*head != NULL)
+    {
+        (*head)->pprev = &node->next;
+    }
+    *head = node;
+    node->pprev = head;
+}
+
+void tw_del(TimerWheel *w, TimerNode *node)
+{
+    if (!tw_pending(node))
+    {
+        return;
+    }
+    *node->pprev = node->next;
+    if (node->next != NULL)
+    {
+        node->next->pprev = node->pprev;
+    }
+    node->next = NULL;
+    node->pprev = NULL;
+    w->count--;
+}
+
+void tw_add(TimerWheel *w, TimerNode *node, uint64_t expires)
+{
+    tw_del(w, node);
+    node->expires = expires;
+    tw_link(w, node);
+    w->count++;
+}
+
+void tw_cascade(TimerWheel *w, int level)
+{
+    int idx = (w->now >> (TW_BITS * level)) & TW_MASK;
+    TimerNode *node = w->slots[level][idx];
+    w->slots[level][idx] = NULL;
+    while (node != NULL)
+    {
+        TimerNode *next = node->next;
+        tw_link(w, node);
+        node = next;
+    }
+}
+
+// Runs every timer due at or before now. fire may add or cancel timers.
+void tw_advance(TimerWheel *w, uint64_t now, TimerFn fire)
+{
+    while (w->now <= now)
+    {
+        if (w->count == 0)
+        {
+            w->now = now + 1;
+            return;
+        }
+
+        int idx = w->now & TW_MASK;
+        for (int level = 1; idx == 0 && level < TW_LEVELS; level++)
+        {
+            tw_cascade(w, level);
+            if (((w->now >> (TW_BITS * level)) & TW_MASK) != 0)
+            {
+                break;
+            }
+        }
+
+        TimerNode *node;
+        while ((node = w->slots[0][idx]) != NULL)
+        {
+            tw_del(w, node);
+            if (node->expires > w->now)
+            {
+                tw_add(w, node, node->expires);
+                continue;
+            }
+            fire(node);
+        }
+        w->now++;
+    }
+}
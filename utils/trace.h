@@ -0,0 +1,203 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+// ------------------ CONSTANTS ------------------
+#define TRACE_TID_CPU 1
+#define TRACE_TID_EVENTS 2
+#define TRACE_TID_LEVEL_BASE 100
+#define TRACE_TID_SLOT_BASE (TRACE_TID_LEVEL_BASE + 4096)
+#define TRACE_MAX_TRACKS (TRACE_TID_SLOT_BASE + 1024)
+
+// Optional Chrome trace-event JSON sink (chrome://tracing, ui.perfetto.dev).
+// Scheduler times are in ms since scheduler start; the trace uses us.
+const char *trace_path = NULL;
+FILE *trace_out = NULL;
+bool trace_need_comma = false;
+uint64_t trace_last_end = 0;
+bool trace_track_named[TRACE_MAX_TRACKS];
+
+void trace_write_string(const char *str)
+{
+    fputc('"', trace_out);
+    for (const char *c = str; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', trace_out);
+            fputc(*c, trace_out);
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            fprintf(trace_out, "\\u%04x", (unsigned char)*c);
+        }
+        else
+        {
+            fputc(*c, trace_out);
+        }
+    }
+    fputc('"', trace_out);
+}
+
+void trace_event_start()
+{
+    fprintf(trace_out, trace_need_comma ? ",\n" : "\n");
+    trace_need_comma = true;
+}
+
+void trace_name_track(int tid, const char *name)
+{
+    if (trace_out == NULL)
+    {
+        return;
+    }
+    if (tid >= 0 && tid < TRACE_MAX_TRACKS)
+    {
+        if (trace_track_named[tid])
+        {
+            return;
+        }
+        trace_track_named[tid] = true;
+    }
+    trace_event_start();
+    fprintf(trace_out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", tid);
+    trace_write_string(name);
+    fprintf(trace_out, "}}");
+}
+
+void trace_begin(const char *scheduler_name)
+{
+    if (trace_path == NULL)
+    {
+        return;
+    }
+    trace_out = fopen(trace_path, "w");
+    if (trace_out == NULL)
+    {
+        perror("trace open failed");
+        return;
+    }
+    trace_need_comma = false;
+    trace_last_end = 0;
+    memset(trace_track_named, 0, sizeof(trace_track_named));
+
+    fprintf(trace_out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    trace_event_start();
+    fprintf(trace_out, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":");
+    trace_write_string(scheduler_name);
+    fprintf(trace_out, "}}");
+    trace_name_track(TRACE_TID_CPU, "CPU slot 0");
+    trace_name_track(TRACE_TID_EVENTS, "Arrivals / boosts");
+}
+
+void trace_end()
+{
+    if (trace_out == NULL)
+    {
+        return;
+    }
+    fprintf(trace_out, "\n]}\n");
+    fclose(trace_out);
+    trace_out = NULL;
+}
+
+void trace_complete(const char *name, const char *cat, int tid, uint64_t start_ms, uint64_t end_ms)
+{
+    trace_event_start();
+    fprintf(trace_out, "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"cat\":\"%s\",\"ts\":%llu,\"dur\":%llu,\"name\":",
+            tid, cat, (unsigned long long)start_ms * 1000, (unsigned long long)(end_ms - start_ms) * 1000);
+    trace_write_string(name);
+    fprintf(trace_out, "}");
+}
+
+void trace_instant(const char *name, const char *cat, int tid, uint64_t ts_ms, const char *scope)
+{
+    trace_event_start();
+    fprintf(trace_out, "{\"ph\":\"i\",\"s\":\"%s\",\"pid\":1,\"tid\":%d,\"cat\":\"%s\",\"ts\":%llu,\"name\":",
+            scope, tid, cat, (unsigned long long)ts_ms * 1000);
+    trace_write_string(name);
+    fprintf(trace_out, "}");
+}
+
+// One slice on the CPU track, mirrored on its queue level's track when
+// level >= 0. Any gap since the previous slice is drawn as idle time.
+void trace_slice(const char *command, int level, uint64_t start_ms, uint64_t end_ms)
+{
+    if (trace_out == NULL)
+    {
+        return;
+    }
+    if (start_ms > trace_last_end)
+    {
+        trace_complete("idle", "idle", TRACE_TID_CPU, trace_last_end, start_ms);
+    }
+    trace_complete(command, "slice", TRACE_TID_CPU, start_ms, end_ms);
+    if (level >= 0)
+    {
+        char track[32];
+        snprintf(track, sizeof(track), "Queue level %d", level);
+        trace_name_track(TRACE_TID_LEVEL_BASE + level, track);
+        trace_complete(command, "slice", TRACE_TID_LEVEL_BASE + level, start_ms, end_ms);
+    }
+    if (end_ms > trace_last_end)
+    {
+        trace_last_end = end_ms;
+    }
+}
+
+// A whole job on its own CPU slot track, for schedulers that run several
+// jobs at once. Slot 0 is the CPU track.
+void trace_slot_slice(const char *command, int slot, uint64_t start_ms, uint64_t end_ms)
+{
+    if (trace_out == NULL)
+    {
+        return;
+    }
+    int tid = TRACE_TID_CPU;
+    if (slot > 0)
+    {
+        char track[32];
+        snprintf(track, sizeof(track), "CPU slot %d", slot);
+        tid = TRACE_TID_SLOT_BASE + slot;
+        trace_name_track(tid, track);
+    }
+    trace_complete(command, "slice", tid, start_ms, end_ms);
+}
+
+void trace_arrival(const char *command, uint64_t ts_ms)
+{
+    if (trace_out != NULL)
+    {
+        trace_instant(command, "arrival", TRACE_TID_EVENTS, ts_ms, "t");
+    }
+}
+
+void trace_preempt(const char *command, uint64_t ts_ms)
+{
+    if (trace_out != NULL)
+    {
+        trace_instant(command, "preempt", TRACE_TID_CPU, ts_ms, "t");
+    }
+}
+
+void trace_demote(const char *command, int to_level, uint64_t ts_ms)
+{
+    if (trace_out == NULL)
+    {
+        return;
+    }
+    char track[32];
+    snprintf(track, sizeof(track), "Queue level %d", to_level);
+    trace_name_track(TRACE_TID_LEVEL_BASE + to_level, track);
+    trace_instant(command, "demote", TRACE_TID_LEVEL_BASE + to_level, ts_ms, "t");
+}
+
+void trace_boost(uint64_t ts_ms)
+{
+    if (trace_out != NULL)
+    {
+        trace_instant("boost", "boost", TRACE_TID_EVENTS, ts_ms, "g");
+    }
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// Pairing heap of job indices keyed by virtual runtime. Nodes live in
+// arrays indexed by job, so insert is O(1) and pop-min is O(log n)
+// amortised without any allocation after vheap_init().
+typedef struct
+{
+    int capacity;
+    int root;
+    int size;
+    uint64_t *key;
+    int *child;
+    int *sibling;
+} VruntimeHeap;
+
+int vheap_init(VruntimeHeap *h, int capacity)
+{
+    h->capacity = capacity;
+    h->root = -1;
+    h->size = 0;
+    h->key = calloc(capacity, sizeof(uint64_t));
+    h->child = malloc(sizeof(int) * capacity);
+    h->sibling = malloc(sizeof(int) * capacity);
+    if (h->key == NULL || h->child == NULL || h->sibling == NULL)
+    {
+        free(h->key);
+        free(h->child);
+        free(h->sibling);
+        return -1;
+    }
+    return 0;
+}
+
+void vheap_free(VruntimeHeap *h)
+{
+    free(h->key);
+    free(h->child);
+    free(h->sibling);
+    h->key = NULL;
+    h->child = NULL;
+    h->sibling = NULL;
+}
+
+bool vheap_less(const VruntimeHeap *h, int a, int b)
+{
+    if (h->key[a] != h->key[b])
+    {
+        return h->key[a] < h->key[b];
+    }
+    return a < b;
+}
+
+int vheap_meld(VruntimeHeap *h, int a, int b)
+{
+    if (a == -1)
+    {
+        return b;
+    }
+    if (b == -1)
+    {
+        return a;
+    }
+    if (vheap_less(h, b, a))
+    {
+        int t = a;
+        a = b;
+        b = t;
+    }
+    h->sibling[b] = h->child[a];
+    h->child[a] = b;
+    return a;
+}
+
+bool vheap_empty(const VruntimeHeap *h)
+{
+    return h->root == -1;
+}
+
+uint64_t vheap_min_key(const VruntimeHeap *h)
+{
+    return h->key[h->root];
+}
+
+void vheap_push(VruntimeHeap *h, int idx, uint64_t key)
+{
+    h->key[idx] = key;
+    h->child[idx] = -1;
+    h->sibling[idx] = -1;
+    h->root = vheap_meld(h, h->root, idx);
+    h->size++;
+}
+
+int vheap_pop(VruntimeHeap *h)
+{
+    int top = h->root;
+    if (top == -1)
+    {
+        return -1;
+    }
+
+    // Two-pass pairing: meld children left to right in pairs, then fold the
+    // pairs right to left. The pairs are chained through sibling[].
+    int pairs = -1;
+    int cur = h->child[top];
+    while (cur != -1)
+    {
+        int a = cur;
+        int b = h->sibling[a];
+        cur = (b == -1) ? -1 : h->sibling[b];
+        h->sibling[a] = -1;
+        if (b != -1)
+        {
+            h->sibling[b] = -1;
+        }
+        int m = vheap_meld(h, a, b);
+        h->sibling[m] = pairs;
+        pairs = m;
+    }
+
+    int root = -1;
+    while (pairs != -1)
+    {
+        int next = h->sibling[pairs];
+        h->sibling[pairs] = -1;
+        root = vheap_meld(h, root, pairs);
+        pairs = next;
+    }
+
+    h->root = root;
+    h->size--;
+    return top;
+}
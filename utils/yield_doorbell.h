@@ -0,0 +1,192 @@
+#pragma once
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#include "mono_clock.h"
+
+// ------------------ CONSTANTS ------------------
+#define YIELD_RING 64
+#define YIELD_ENV "SCHED_YIELD_PID"
+
+// With yield_doorbell_enabled, jobs find the scheduler's pid in
+// $SCHED_YIELD_PID and give up the rest of their slice by sending it
+// SIGRTMIN, e.g. sigqueue(pid, SIGRTMIN, (union sigval){.sival_int = ms}).
+// A positive value is a hint for the job's next burst in ms. The handler only
+// queues the request; the dispatch loop stops the job on its next poll, and
+// the signal cuts short any sleep the loop is in.
+bool yield_doorbell_enabled = false;
+
+typedef struct
+{
+    atomic_int ready;
+    pid_t pid;
+    int hint_ms;
+    uint64_t ns;
+} YieldEntry;
+
+YieldEntry yield_ring[YIELD_RING];
+atomic_uint yield_head = 0;
+unsigned yield_tail = 0;
+uint64_t yield_seen_ns = 0;
+
+atomic_int yield_overflows = 0;
+int yield_count = 0;
+int yield_hints = 0;
+uint64_t yield_latency_sum_ns = 0;
+uint64_t yield_latency_max_ns = 0;
+
+void yield_handler(int sig, siginfo_t *info, void *ctx)
+{
+    unsigned slot = atomic_fetch_add(&yield_head, 1) % YIELD_RING;
+    YieldEntry *e = &yield_ring[slot];
+    if (atomic_load(&e->ready))
+    {
+        atomic_fetch_add(&yield_overflows, 1);
+        return;
+    }
+    e->pid = info->si_pid;
+    e->hint_ms = info->si_code == SI_QUEUE ? info->si_value.sival_int : 0;
+    e->ns = mono_time_ns();
+    atomic_store(&e->ready, 1);
+}
+
+void yield_signal_mask(int how)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGRTMIN);
+    pthread_sigmask(how, &set, NULL);
+}
+
+// Before any helper thread starts, so they inherit the signal blocked and
+// it is always delivered to the dispatch thread once yield_arm() runs.
+void yield_begin()
+{
+    atomic_store(&yield_overflows, 0);
+    yield_count = 0;
+    yield_hints = 0;
+    yield_latency_sum_ns = 0;
+    yield_latency_max_ns = 0;
+    if (!yield_doorbell_enabled)
+    {
+        return;
+    }
+    yield_signal_mask(SIG_BLOCK);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = yield_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGRTMIN, &sa, NULL);
+
+    char pid[32];
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    setenv(YIELD_ENV, pid, 1);
+}
+
+// In the dispatch thread, before the first job is forked.
+void yield_arm()
+{
+    if (yield_doorbell_enabled)
+    {
+        yield_signal_mask(SIG_UNBLOCK);
+    }
+}
+
+pid_t yield_parent_of(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    int ppid = -1;
+    if (fscanf(fp, "%*d (%*[^)]) %*c %d", &ppid) != 1)
+    {
+        ppid = -1;
+    }
+    fclose(fp);
+    return ppid;
+}
+
+// Whether the running job rang the doorbell: the job itself, a process in
+// its group (pipeline stages), or a direct child such as /bin/kill.
+// Requests from anyone else are stale and dropped.
+bool yield_requested(pid_t pid, int *hint_ms)
+{
+    bool found = false;
+    *hint_ms = 0;
+    unsigned head = atomic_load(&yield_head);
+    if (head - yield_tail > YIELD_RING)
+    {
+        yield_tail = head - YIELD_RING;
+    }
+    // The handler runs on this thread, so it never holds an entry half
+    // written here; an entry behind head that is not ready was dropped on
+    // overflow and is skipped rather than waited for.
+    for (; yield_tail != head; yield_tail++)
+    {
+        YieldEntry *e = &yield_ring[yield_tail % YIELD_RING];
+        if (!atomic_load(&e->ready))
+        {
+            continue;
+        }
+        if (e->pid == pid || getpgid(e->pid) == pid || yield_parent_of(e->pid) == pid)
+        {
+            found = true;
+            yield_seen_ns = e->ns;
+            if (e->hint_ms > 0)
+            {
+                *hint_ms = e->hint_ms;
+            }
+        }
+        atomic_store(&e->ready, 0);
+    }
+    return found;
+}
+
+// Right after the yielding job was stopped.
+void yield_stopped(int hint_ms)
+{
+    uint64_t ns = mono_time_ns() - yield_seen_ns;
+    yield_count++;
+    yield_hints += hint_ms > 0;
+    yield_latency_sum_ns += ns;
+    if (ns > yield_latency_max_ns)
+    {
+        yield_latency_max_ns = ns;
+    }
+}
+
+void yield_end()
+{
+    if (!yield_doorbell_enabled)
+    {
+        return;
+    }
+    unsetenv(YIELD_ENV);
+    signal(SIGRTMIN, SIG_IGN);
+    yield_signal_mask(SIG_UNBLOCK);
+    if (yield_count > 0)
+    {
+        printf("\nYields: %d (%d with a burst hint), doorbell to stop mean %.1f us, max %.1f us\n",
+               yield_count, yield_hints, yield_latency_sum_ns / 1000.0 / yield_count,
+               yield_latency_max_ns / 1000.0);
+    }
+    if (atomic_load(&yield_overflows) > 0)
+    {
+        printf("  %d doorbell rings dropped on a full ring\n", atomic_load(&yield_overflows));
+    }
+}